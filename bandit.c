@@ -0,0 +1,139 @@
+#include "bandit.h"
+#include "monotonic.h"
+
+#include <math.h>
+
+
+static OrderHeuristic DEFAULT_COMBINED_HEURISTICS[2] = {most_frequent_digit_heuristic, max_neighbors_heuristic};
+static void* DEFAULT_COMBINED_STATES[2] = {NULL, NULL};
+static CombinedHeuristic DEFAULT_COMBINED = {DEFAULT_COMBINED_HEURISTICS, DEFAULT_COMBINED_STATES, 2};
+
+
+void bandit_init(BanditHeuristic* bandit, BanditPolicy policy, uint64_t seed) {
+    bandit->policy = policy;
+    bandit->arm_count = 0;
+    bandit->current = 0;
+    bandit->min_reward = INFINITY;
+    bandit->max_reward = 0.0;
+    bandit->search_start = 0.0;
+    rng_seed(&bandit->rng, seed);
+}
+
+
+bool bandit_add_arm(BanditHeuristic* bandit, OrderHeuristic heuristic, void* state, const char* name) {
+    if (bandit->arm_count >= BANDIT_MAX_ARMS)
+        return false;
+    BanditArm* arm = bandit->arms + bandit->arm_count++;
+    arm->heuristic = heuristic;
+    arm->state = state;
+    arm->name = name;
+    arm->pulls = 0;
+    arm->reward_sum = 0.0;
+    arm->reward_square_sum = 0.0;
+    return true;
+}
+
+
+void bandit_add_default_arms(BanditHeuristic* bandit) {
+    bandit_add_arm(bandit, max_neighbors_heuristic, NULL, "max_neighbors");
+    bandit_add_arm(bandit, min_neighbors_heuristic, NULL, "min_neighbors");
+    bandit_add_arm(bandit, most_frequent_digit_heuristic, NULL, "most_frequent_digit");
+    bandit_add_arm(bandit, least_frequent_digit_heuristic, NULL, "least_frequent_digit");
+    bandit_add_arm(bandit, combined_heuristic, &DEFAULT_COMBINED, "combined");
+}
+
+
+// standard normal sample (Box-Muller)
+double normal_sample(Rng* rng) {
+    double u = ((double) rng_next(rng) + 1.0) / 4294967297.0;
+    double v = (double) rng_next(rng) / 4294967296.0;
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+
+uint32_t select_arm(BanditHeuristic* bandit) {
+    uint64_t total_pulls = 0;
+    for (uint32_t i = 0; i < bandit->arm_count; ++i) {
+        // every arm is tried once before the policy takes over
+        if (bandit->arms[i].pulls == 0)
+            return i;
+        total_pulls += bandit->arms[i].pulls;
+    }
+
+    // rewards are mapped to [0, 1] so that the exploration term has the right magnitude
+    // the arms usually differ by a few percent only, so the range observed so far is used rather than [0, max]
+    double range = bandit->max_reward - bandit->min_reward;
+    double scale = range > 0.0 ? 1.0 / range : 1.0;
+    uint32_t best = 0;
+    double best_score = -INFINITY;
+    for (uint32_t i = 0; i < bandit->arm_count; ++i) {
+        const BanditArm* arm = bandit->arms + i;
+        double pulls = (double) arm->pulls;
+        double mean = (arm->reward_sum / pulls - bandit->min_reward) * scale;
+        double score;
+        if (bandit->policy == BANDIT_UCB) {
+            score = mean + sqrt(2.0 * log((double) total_pulls) / pulls);
+        } else {
+            // a single search says nothing about the spread, assume the whole range then
+            double variance = 1.0;
+            if (arm->pulls > 1) {
+                double raw_mean = arm->reward_sum / pulls;
+                double raw_variance = fmax(arm->reward_square_sum / pulls - raw_mean * raw_mean, 0.0);
+                variance = raw_variance * scale * scale * pulls / (pulls - 1.0);
+            }
+            score = mean + sqrt(variance / pulls) * normal_sample(&bandit->rng);
+        }
+        if (score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+    return best;
+}
+
+
+void bandit_begin_search(BanditHeuristic* bandit) {
+    bandit->current = bandit->arm_count ? select_arm(bandit) : 0;
+    bandit->search_start = thread_cpu_seconds();
+}
+
+
+void bandit_end_search(BanditHeuristic* bandit, uint32_t hints_removed) {
+    if (bandit->arm_count == 0)
+        return;
+    // the clock resolution may be coarse, very short searches count as one microsecond
+    double seconds = fmax(thread_cpu_seconds() - bandit->search_start, 1e-6);
+    double reward = hints_removed / seconds;
+    BanditArm* arm = bandit->arms + bandit->current;
+    ++arm->pulls;
+    arm->reward_sum += reward;
+    arm->reward_square_sum += reward * reward;
+    bandit->min_reward = fmin(bandit->min_reward, reward);
+    bandit->max_reward = fmax(bandit->max_reward, reward);
+}
+
+
+void bandit_print_stats(const BanditHeuristic* bandit, FILE* out) {
+    for (uint32_t i = 0; i < bandit->arm_count; ++i) {
+        const BanditArm* arm = bandit->arms + i;
+        double mean = arm->pulls ? arm->reward_sum / (double) arm->pulls : 0.0;
+        fprintf(out, "%-22s %8llu searches %12.1f hints removed per cpu-second\n",
+                arm->name ? arm->name : "?", (unsigned long long) arm->pulls, mean);
+    }
+}
+
+
+uint32_t bandit_heuristic(
+        OrderedFieldSubset* candidate_fields,
+        uint32_t candidate_offset,
+        uint32_t candidate_count,
+        const Sudoku* instance,
+        uint32_t max_candidates_to_generate,
+        void* state) {
+
+    BanditHeuristic* bandit = (BanditHeuristic*) state;
+    if (bandit->arm_count == 0)
+        return 0;
+    BanditArm* arm = bandit->arms + bandit->current;
+    return arm->heuristic(candidate_fields, candidate_offset, candidate_count, instance, max_candidates_to_generate, arm->state);
+}
@@ -0,0 +1,62 @@
+#ifndef BANDIT_H
+#define BANDIT_H
+
+#include "heuristics.h"
+#include "rng.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// meta-heuristic choosing one of several heuristics (arms) per search, see bandit_heuristic
+// which heuristic works best depends on the strategy, the hint target and the budget
+// so the bandit measures the hints removed per cpu-second of every search and shifts the searches towards the best arms
+
+#define BANDIT_MAX_ARMS 8u
+
+typedef enum {
+    // upper confidence bound (UCB1) over rewards normalized to the range observed so far
+    BANDIT_UCB,
+    // samples every arm from a normal approximation of its mean reward and takes the best sample
+    BANDIT_THOMPSON
+} BanditPolicy;
+
+typedef struct {
+    OrderHeuristic heuristic;
+    void* state;
+    const char* name;
+    uint64_t pulls;
+    // in hints removed per cpu-second
+    double reward_sum;
+    double reward_square_sum;
+} BanditArm;
+
+// pass as the state of bandit_heuristic, contains no pointers except for the arms' states and names
+// so a copy learns independently, e.g. one per thread
+typedef struct {
+    BanditPolicy policy;
+    BanditArm arms[BANDIT_MAX_ARMS];
+    uint32_t arm_count;
+    uint32_t current;
+    double min_reward;
+    double max_reward;
+    double search_start;
+    Rng rng;
+} BanditHeuristic;
+
+void bandit_init(BanditHeuristic* bandit, BanditPolicy policy, uint64_t seed);
+// returns false if there are BANDIT_MAX_ARMS arms already
+bool bandit_add_arm(BanditHeuristic* bandit, OrderHeuristic heuristic, void* state, const char* name);
+// all heuristics of heuristics.h except no_heuristic, combined_heuristic combines the most frequent digit and max neighbors heuristics
+void bandit_add_default_arms(BanditHeuristic* bandit);
+
+// call around every search using bandit_heuristic, on the thread running the search
+// begin chooses the arm, end rewards it with the hints removed per cpu-second since begin
+void bandit_begin_search(BanditHeuristic* bandit);
+void bandit_end_search(BanditHeuristic* bandit, uint32_t hints_removed);
+
+// one line per arm: name, searches, mean reward
+void bandit_print_stats(const BanditHeuristic* bandit, FILE* out);
+
+DECLARE_HEURISTIC(bandit_heuristic)
+
+#endif
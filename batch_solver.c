@@ -0,0 +1,314 @@
+#include "batch_solver.h"
+#include "utils.h"
+
+#include <stdbool.h>
+
+#ifdef BATCH_VECTORIZED
+
+// one entry per lane, operators act on all lanes at once
+typedef uint16_t Lanes __attribute__((vector_size(BATCH_LANES * sizeof(uint16_t))));
+
+// structure of arrays: one vector of lanes per field
+// values are one-hot encoded digits or 0, candidates are bit sets of size 9
+typedef struct {
+    Lanes values[81];
+    Lanes candidates[81];
+    // all bits set while the lane is active, 0 once it has been decided or is unused
+    Lanes active;
+    Lanes contradiction;
+} Batch;
+
+
+// the 27 blocks, listed field by field
+static const uint8_t block_fields[27][9] = {
+        // rows
+        { 0,  1,  2,  3,  4,  5,  6,  7,  8}, { 9, 10, 11, 12, 13, 14, 15, 16, 17}, {18, 19, 20, 21, 22, 23, 24, 25, 26},
+        {27, 28, 29, 30, 31, 32, 33, 34, 35}, {36, 37, 38, 39, 40, 41, 42, 43, 44}, {45, 46, 47, 48, 49, 50, 51, 52, 53},
+        {54, 55, 56, 57, 58, 59, 60, 61, 62}, {63, 64, 65, 66, 67, 68, 69, 70, 71}, {72, 73, 74, 75, 76, 77, 78, 79, 80},
+        // columns
+        { 0,  9, 18, 27, 36, 45, 54, 63, 72}, { 1, 10, 19, 28, 37, 46, 55, 64, 73}, { 2, 11, 20, 29, 38, 47, 56, 65, 74},
+        { 3, 12, 21, 30, 39, 48, 57, 66, 75}, { 4, 13, 22, 31, 40, 49, 58, 67, 76}, { 5, 14, 23, 32, 41, 50, 59, 68, 77},
+        { 6, 15, 24, 33, 42, 51, 60, 69, 78}, { 7, 16, 25, 34, 43, 52, 61, 70, 79}, { 8, 17, 26, 35, 44, 53, 62, 71, 80},
+        // squares
+        { 0,  1,  2,  9, 10, 11, 18, 19, 20}, { 3,  4,  5, 12, 13, 14, 21, 22, 23}, { 6,  7,  8, 15, 16, 17, 24, 25, 26},
+        {27, 28, 29, 36, 37, 38, 45, 46, 47}, {30, 31, 32, 39, 40, 41, 48, 49, 50}, {33, 34, 35, 42, 43, 44, 51, 52, 53},
+        {54, 55, 56, 63, 64, 65, 72, 73, 74}, {57, 58, 59, 66, 67, 68, 75, 76, 77}, {60, 61, 62, 69, 70, 71, 78, 79, 80}
+};
+
+
+static inline bool any_lane(Lanes masks) {
+    uint16_t any = 0;
+    for (uint32_t l = 0; l < BATCH_LANES; ++l) {
+        any |= masks[l];
+    }
+    return any != 0;
+}
+
+
+// comparisons yield all bits set in lanes where they hold
+static inline Lanes is_zero(Lanes lanes) {
+    return (Lanes) (lanes == 0);
+}
+
+
+// removes the digits placed in any block from the candidates of its fields, then places all naked singles
+// placements only take effect on the peers in the next round, digits placed twice in a block are detected there
+// returns true if any lane made progress
+bool batch_singles(Batch* batch) {
+    Lanes used[27];
+    for (uint32_t n = 0; n < 27u; ++n) {
+        const uint8_t* fields = block_fields[n];
+        Lanes once_or_more = {0}, twice_or_more = {0};
+        for (uint32_t i = 0; i < 9; ++i) {
+            Lanes values = batch->values[fields[i]];
+            twice_or_more |= once_or_more & values;
+            once_or_more |= values;
+        }
+        used[n] = once_or_more;
+        batch->contradiction |= ~is_zero(twice_or_more);
+    }
+
+    Lanes progress = {0};
+    for (uint32_t field = 0; field < 81u; ++field) {
+        uint32_t r = field / 9u, c = field % 9u;
+        Lanes empty = is_zero(batch->values[field]);
+        Lanes remaining = batch->candidates[field] & ~(used[r] | used[9u + c] | used[18u + r / 3u * 3u + c / 3u]) & empty;
+        Lanes single = remaining & batch->active & is_zero(remaining & (remaining - 1));
+        batch->contradiction |= is_zero(remaining) & empty;
+        batch->values[field] |= single;
+        batch->candidates[field] = remaining & ~single;
+        progress |= single;
+    }
+    return any_lane(progress);
+}
+
+
+// places every digit that fits into a single field of a block only
+// returns true if any lane made progress
+bool batch_hidden_singles(Batch* batch) {
+    Lanes progress = {0};
+    for (uint32_t n = 0; n < 27u; ++n) {
+        const uint8_t* fields = block_fields[n];
+        Lanes once_or_more = {0}, twice_or_more = {0}, placed = {0};
+        for (uint32_t i = 0; i < 9; ++i) {
+            Lanes candidates = batch->candidates[fields[i]];
+            twice_or_more |= once_or_more & candidates;
+            once_or_more |= candidates;
+            placed |= batch->values[fields[i]];
+        }
+        // every digit has to be placed or placeable in every block
+        batch->contradiction |= ~(Lanes) ((once_or_more | placed) == (uint16_t) ALL_CANDIDATES);
+        Lanes once = once_or_more & ~twice_or_more & ~placed & batch->active;
+        if (!any_lane(once))
+            continue;
+        for (uint32_t i = 0; i < 9; ++i) {
+            Lanes hidden = batch->candidates[fields[i]] & once;
+            // two digits that can only go into the same field
+            batch->contradiction |= ~is_zero(hidden & (hidden - 1));
+            batch->values[fields[i]] |= hidden;
+            batch->candidates[fields[i]] &= is_zero(hidden);
+            progress |= hidden;
+        }
+    }
+    return any_lane(progress);
+}
+
+
+void sudoku_propagate_batch(Sudoku* instances, uint32_t count, BatchOutcome* outcomes) {
+    Batch batch;
+    for (uint32_t l = 0; l < BATCH_LANES; ++l) {
+        bool used = l < count;
+        batch.active[l] = used ? 0xffffu : 0;
+        batch.contradiction[l] = 0;
+        for (uint32_t field = 0; field < 81u; ++field) {
+            uint32_t data = used ? instances[l].data[field] : 0;
+            batch.values[field][l] = (uint16_t) (data & LOWER);
+            batch.candidates[field][l] = (uint16_t) (data >> SHIFT);
+        }
+    }
+
+    while (true) {
+        bool progress = batch_singles(&batch);
+        progress |= batch_hidden_singles(&batch);
+        // contradicting lanes are done and must not keep the others busy
+        batch.active &= ~batch.contradiction;
+        if (!progress || !any_lane(batch.active))
+            break;
+    }
+
+    for (uint32_t l = 0; l < count; ++l) {
+        if (batch.contradiction[l]) {
+            outcomes[l] = BATCH_CONTRADICTION;
+            continue;
+        }
+        Sudoku* instance = instances + l;
+        instance->blank_fields = 0;
+        for (uint32_t field = 0; field < 81u; ++field) {
+            instance->data[field] = batch.values[field][l] | ((uint32_t) batch.candidates[field][l] << SHIFT);
+            instance->blank_fields += batch.values[field][l] == 0;
+        }
+        // solved iff every block contains every digit
+        uint16_t complete = ALL_CANDIDATES;
+        for (uint32_t n = 0; n < 27u; ++n) {
+            uint16_t placed = 0;
+            for (uint32_t i = 0; i < 9; ++i) {
+                placed |= batch.values[block_fields[n][i]][l];
+            }
+            complete &= placed;
+        }
+        outcomes[l] = complete == ALL_CANDIDATES ? BATCH_SOLVED : BATCH_UNDECIDED;
+    }
+}
+
+
+typedef struct {
+    Sudoku instance;
+    // next node on the same search stack
+    uint32_t next;
+    // fields branched on above this node
+    uint32_t depth;
+} SearchNode;
+
+// node pool shared by all search stacks, it lives on the call stack
+// nodes that do not fit are searched by the scalar solver instead
+#define SEARCH_POOL_SIZE 128u
+#define NO_NODE 0xffffffffu
+
+
+// every instance runs its own depth-first search, so that a solution is found as early as possible
+// each round fills the lanes with the top node of up to BATCH_LANES different instances
+// an instance has no solution once its search stack is exhausted
+void sudoku_has_solution_batch(const Sudoku* instances, uint32_t count, bool* has_solution, CheckTier* tiers) {
+    SearchNode pool[SEARCH_POOL_SIZE];
+    uint32_t free_list = NO_NODE;
+    uint32_t unused = 0;
+    uint32_t top[BATCH_MAX_INSTANCES];
+    // deepest node propagated for each instance
+    uint32_t deepest[BATCH_MAX_INSTANCES];
+
+    for (uint32_t i = 0; i < count; ++i) {
+        has_solution[i] = false;
+        top[i] = NO_NODE;
+        deepest[i] = 0;
+    }
+
+    // instances started so far, and the instance to continue the round-robin at
+    uint32_t started = 0;
+    uint32_t next_instance = 0;
+
+    while (true) {
+        Sudoku lanes[BATCH_LANES];
+        uint32_t owners[BATCH_LANES];
+        uint32_t depths[BATCH_LANES];
+        uint32_t lane_count = 0;
+
+        // start new instances first, then continue the searches round-robin
+        while (started < count && lane_count < BATCH_LANES) {
+            lanes[lane_count] = instances[started];
+            depths[lane_count] = 0;
+            owners[lane_count++] = started++;
+        }
+        for (uint32_t k = 0; k < count && lane_count < BATCH_LANES; ++k) {
+            uint32_t i = (next_instance + k) % count;
+            if (top[i] == NO_NODE)
+                continue;
+            uint32_t node = top[i];
+            top[i] = pool[node].next;
+            pool[node].next = free_list;
+            free_list = node;
+            lanes[lane_count] = pool[node].instance;
+            depths[lane_count] = pool[node].depth;
+            deepest[i] = depths[lane_count] > deepest[i] ? depths[lane_count] : deepest[i];
+            owners[lane_count++] = i;
+        }
+        if (lane_count == 0)
+            break;
+        next_instance = (owners[lane_count - 1] + 1) % count;
+
+        BatchOutcome outcomes[BATCH_LANES];
+        sudoku_propagate_batch(lanes, lane_count, outcomes);
+
+        for (uint32_t l = 0; l < lane_count; ++l) {
+            uint32_t owner = owners[l];
+            if (outcomes[l] == BATCH_SOLVED) {
+                has_solution[owner] = true;
+            }
+            if (outcomes[l] != BATCH_UNDECIDED)
+                continue;
+
+            // branch on an empty field with the lowest candidate count
+            uint32_t mindex = 0, min_count = 10u;
+            for (uint32_t field = 0; field < 81u; ++field) {
+                uint32_t candidate_count = population_count(lanes[l].data[field] & UPPER);
+                if (!(lanes[l].data[field] & LOWER) && candidate_count < min_count) {
+                    min_count = candidate_count;
+                    mindex = field;
+                }
+            }
+            uint32_t candidates = lanes[l].data[mindex] >> SHIFT;
+            while (candidates) {
+                uint32_t candidate = 1u << highest_set_bit_index(candidates);
+                candidates &= ~candidate;
+                uint32_t node = free_list;
+                if (node != NO_NODE) {
+                    free_list = pool[node].next;
+                } else if (unused < SEARCH_POOL_SIZE) {
+                    node = unused++;
+                } else {
+                    Sudoku child = lanes[l];
+                    // counted as a full search
+                    deepest[owner] = UINT32_MAX;
+                    sudoku_put_one_hot_value(&child, mindex, candidate);
+                    if (sudoku_solve(&child)) {
+                        has_solution[owner] = true;
+                        break;
+                    }
+                    continue;
+                }
+                pool[node].instance = lanes[l];
+                sudoku_put_one_hot_value(&pool[node].instance, mindex, candidate);
+                pool[node].depth = depths[l] + 1;
+                pool[node].next = top[owner];
+                top[owner] = node;
+            }
+        }
+
+        // release the remaining search nodes of decided instances
+        for (uint32_t l = 0; l < lane_count; ++l) {
+            uint32_t owner = owners[l];
+            while (has_solution[owner] && top[owner] != NO_NODE) {
+                uint32_t node = top[owner];
+                top[owner] = pool[node].next;
+                pool[node].next = free_list;
+                free_list = node;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; tiers && i < count; ++i) {
+        tiers[i] = deepest[i] < CHECK_SEARCH ? (CheckTier) deepest[i] : CHECK_SEARCH;
+    }
+}
+
+#else
+
+// without vector extensions there is nothing to gain from lockstep propagation
+void sudoku_propagate_batch(Sudoku* instances, uint32_t count, BatchOutcome* outcomes) {
+    (void) instances;
+    for (uint32_t l = 0; l < count; ++l) {
+        outcomes[l] = BATCH_UNDECIDED;
+    }
+}
+
+
+// the scalar solver does not tell how deep it went
+void sudoku_has_solution_batch(const Sudoku* instances, uint32_t count, bool* has_solution, CheckTier* tiers) {
+    for (uint32_t i = 0; i < count; ++i) {
+        Sudoku copy = instances[i];
+        has_solution[i] = sudoku_solve(&copy);
+        if (tiers)
+            tiers[i] = CHECK_SEARCH;
+    }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BATCH_SOLVER_H
+#define BATCH_SOLVER_H
+
+#include "sudoku.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// number of instances processed in lockstep, 8 lanes of 16 bits fill one 128 bit vector register
+// wider batches were measured to be slower since more lanes branch differently
+#define BATCH_LANES 8u
+#define BATCH_MAX_INSTANCES 81u
+
+// lockstep propagation relies on the vector extensions of GCC and Clang
+// other compilers fall back to solving the instances one by one
+#if defined(__GNUC__) || defined(__clang__)
+#define BATCH_VECTORIZED
+#endif
+
+// how far the search for an instance had to go before it was decided
+typedef enum {
+    // propagation of the instance itself filled it in or ran into a contradiction
+    CHECK_PROPAGATION,
+    // propagating every candidate of a single field decided it
+    CHECK_PROBE,
+    // branching on further fields was needed
+    CHECK_SEARCH
+} CheckTier;
+
+typedef enum {
+    // propagation got stuck, a branch is required to decide the instance
+    BATCH_UNDECIDED,
+    // propagation filled in all fields, the instance has a solution
+    BATCH_SOLVED,
+    // propagation found a contradiction, the instance has no solution
+    BATCH_CONTRADICTION
+} BatchOutcome;
+
+// applies naked and hidden singles to up to BATCH_LANES instances in lockstep until none of them make progress
+// the propagated instances are written back unless they turned out contradictory
+void sudoku_propagate_batch(Sudoku* instances, uint32_t count, BatchOutcome* outcomes);
+
+// decides for each of up to BATCH_MAX_INSTANCES instances whether it has at least one solution
+// every search node is propagated by sudoku_propagate_batch, nodes requiring a branch are split into one node per candidate
+// these children are fed back into later batches, so the lanes stay filled even though each instance branches differently
+// tiers may be NULL, otherwise it receives how each instance was decided
+void sudoku_has_solution_batch(const Sudoku* instances, uint32_t count, bool* has_solution, CheckTier* tiers);
+
+#endif
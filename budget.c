@@ -0,0 +1,99 @@
+#include "budget.h"
+#include "monotonic.h"
+
+#include <math.h>
+
+
+void budget_init(SearchBudget* budget) {
+    budget->deadline = INFINITY;
+    // a node takes tens of microseconds, so the deadline is overshot by well below a millisecond
+    budget->clock_interval = 8;
+    budget->max_nodes = UINT64_MAX;
+    budget->max_checks = UINT64_MAX;
+    budget->cancel = NULL;
+    budget->nodes = 0;
+    budget->checks = 0;
+    budget->nodes_until_clock = 1;
+    budget->exhausted = false;
+}
+
+
+void budget_set_seconds(SearchBudget* budget, double seconds) {
+    budget->deadline = monotonic_seconds() + seconds;
+    budget->nodes_until_clock = 1;
+}
+
+
+bool is_cancelled(CancelFlag* flag) {
+#ifdef __STDC_NO_ATOMICS__
+    return *flag != 0;
+#else
+    return atomic_load_explicit(flag, memory_order_relaxed) != 0;
+#endif
+}
+
+
+bool budget_spend_node(SearchBudget* budget) {
+    if (budget->exhausted)
+        return false;
+    if (budget->nodes >= budget->max_nodes || budget->checks >= budget->max_checks || (budget->cancel && is_cancelled(budget->cancel))) {
+        budget->exhausted = true;
+        return false;
+    }
+    if (--budget->nodes_until_clock == 0) {
+        budget->nodes_until_clock = budget->clock_interval;
+        if (budget->deadline != INFINITY && monotonic_seconds() >= budget->deadline) {
+            budget->exhausted = true;
+            return false;
+        }
+    }
+    ++budget->nodes;
+    return true;
+}
+
+
+void budget_spend_checks(SearchBudget* budget, uint64_t checks) {
+    budget->checks += checks;
+}
+
+
+bool budget_exhausted(const SearchBudget* budget) {
+    return budget->exhausted;
+}
+
+
+void budget_slice(const SearchBudget* parent, uint64_t checks, SearchBudget* slice) {
+    *slice = *parent;
+    if (parent->checks < parent->max_checks && parent->max_checks - parent->checks > checks)
+        slice->max_checks = parent->checks + checks;
+}
+
+
+bool budget_merge_slice(SearchBudget* parent, const SearchBudget* slice) {
+    parent->nodes = slice->nodes;
+    parent->checks = slice->checks;
+    parent->nodes_until_clock = slice->nodes_until_clock;
+    // a slice ending at its own check limit leaves the parent usable
+    bool slice_limit = slice->max_checks < parent->max_checks && slice->checks >= slice->max_checks;
+    if (slice->exhausted && !slice_limit)
+        parent->exhausted = true;
+    return !parent->exhausted;
+}
+
+
+void budget_cancel(CancelFlag* flag) {
+#ifdef __STDC_NO_ATOMICS__
+    *flag = 1;
+#else
+    atomic_store(flag, 1);
+#endif
+}
+
+
+void budget_reset_cancel(CancelFlag* flag) {
+#ifdef __STDC_NO_ATOMICS__
+    *flag = 0;
+#else
+    atomic_store(flag, 0);
+#endif
+}
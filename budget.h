@@ -0,0 +1,57 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __STDC_NO_ATOMICS__
+typedef volatile int CancelFlag;
+#else
+#include <stdatomic.h>
+typedef atomic_int CancelFlag;
+#endif
+
+// limits of a search, it ends as soon as any of them is reached
+// node and check budgets are reproducible, so that benchmarks do not depend on the machine or its load
+// a node is one removal step, a check is one hint tested for removability
+// taken by every search whose running time is not bounded by the grid: the hint removal strategies of generator.h,
+// removal_search.h and pattern.h, and (as a deadline and cancel flag) sudoku_count_solutions
+// the single solves below them (sudoku_solve, the batch solver, rate_instance) take none: each decides one grid,
+// and a removal step or check spends its budget before running them, so they are not cancelled midway
+typedef struct {
+    // monotonic_seconds() at which the search ends
+    double deadline;
+    // the clock is only read once every clock_interval nodes
+    uint32_t clock_interval;
+    uint64_t max_nodes;
+    uint64_t max_checks;
+    // other threads may set the flag to a non-zero value to end the search, NULL if not cancellable
+    CancelFlag* cancel;
+
+    uint64_t nodes;
+    uint64_t checks;
+    uint32_t nodes_until_clock;
+    bool exhausted;
+} SearchBudget;
+
+// initializes an unlimited budget
+void budget_init(SearchBudget* budget);
+// sets the deadline relative to now
+void budget_set_seconds(SearchBudget* budget, double seconds);
+
+// returns false if the budget is exhausted, in which case the node must not be visited
+bool budget_spend_node(SearchBudget* budget);
+void budget_spend_checks(SearchBudget* budget, uint64_t checks);
+bool budget_exhausted(const SearchBudget* budget);
+
+// a budget for one part of a search, e.g. one restart, limited to at most checks more removability checks
+// all other limits and the counters are shared with the parent
+void budget_slice(const SearchBudget* parent, uint64_t checks, SearchBudget* slice);
+// accounts the work of the slice to the parent, returns false if the parent is exhausted as well
+bool budget_merge_slice(SearchBudget* parent, const SearchBudget* slice);
+
+// safe to call from any thread and from signal handlers
+void budget_cancel(CancelFlag* flag);
+void budget_reset_cancel(CancelFlag* flag);
+
+#endif
@@ -0,0 +1,447 @@
+#include "daemon.h"
+#include "sudokugen.h"
+#include "monotonic.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_POOLS (DAEMON_MAX_HINTS - DAEMON_MIN_HINTS + 1u)
+#define LINE_LENGTH (SUDOKUGEN_CHARS_PER_INSTANCE + 1u)
+
+// consumption rates are smoothed over intervals of this length
+static const double RATE_INTERVAL_SECONDS = 1.0;
+static const double RATE_SMOOTHING = 0.3;
+
+
+typedef struct {
+    // stack of instances, SUDOKUGEN_CHARS_PER_INSTANCE characters each
+    char* instances;
+    uint32_t size;
+    // instances requested with this pool's hint count as upper bound
+    uint64_t requested_since_update;
+    // requested instances per second
+    double rate;
+    // time budget per instance when generating for this pool
+    float seconds_per_instance;
+} Pool;
+
+typedef struct {
+    DaemonConfig config;
+    Pool pools[NUM_POOLS];
+    double last_rate_update;
+    pthread_mutex_t lock;
+    pthread_cond_t demand;
+    // generator threads that have not returned yet
+    uint32_t running_generators;
+} Daemon;
+
+static volatile sig_atomic_t shutdown_requested = 0;
+
+
+DaemonConfig daemon_default_config() {
+    DaemonConfig config;
+    config.socket_path = "/tmp/gensudoku.sock";
+    config.num_threads = 4;
+    config.pool_capacity = 4096;
+    config.min_fill = 64;
+    config.min_fill_hints = 23;
+    config.min_target_hints = 20;
+    config.refill_horizon_seconds = 10.0f;
+    config.min_seconds_per_instance = 0.01f;
+    config.max_seconds_per_instance = 5.0f;
+    return config;
+}
+
+
+uint32_t pool_target(const Daemon* daemon, uint32_t pool_index) {
+    const Pool* pool = daemon->pools + pool_index;
+    double target = pool->rate * daemon->config.refill_horizon_seconds;
+    if (DAEMON_MIN_HINTS + pool_index >= daemon->config.min_fill_hints && target < daemon->config.min_fill)
+        target = daemon->config.min_fill;
+    if (target > daemon->config.pool_capacity)
+        target = daemon->config.pool_capacity;
+    // round up so that any demand at all keeps at least one instance in stock
+    return (uint32_t) (target + 0.999);
+}
+
+
+// expects the lock to be held
+void update_rates(Daemon* daemon) {
+    double now = monotonic_seconds();
+    double elapsed = now - daemon->last_rate_update;
+    if (elapsed < RATE_INTERVAL_SECONDS)
+        return;
+    for (uint32_t i = 0; i < NUM_POOLS; ++i) {
+        Pool* pool = daemon->pools + i;
+        double current_rate = (double) pool->requested_since_update / elapsed;
+        pool->rate = (1.0 - RATE_SMOOTHING) * pool->rate + RATE_SMOOTHING * current_rate;
+        pool->requested_since_update = 0;
+    }
+    daemon->last_rate_update = now;
+}
+
+
+// expects the lock to be held
+// returns the pool with the largest relative deficit, or NUM_POOLS if all pools are sufficiently full
+uint32_t neediest_pool(const Daemon* daemon) {
+    uint32_t neediest = NUM_POOLS;
+    double max_deficit = 0.0;
+    for (uint32_t i = daemon->config.min_target_hints - DAEMON_MIN_HINTS; i < NUM_POOLS; ++i) {
+        uint32_t target = pool_target(daemon, i);
+        if (daemon->pools[i].size >= target)
+            continue;
+        double deficit = (double) (target - daemon->pools[i].size) / target;
+        if (deficit > max_deficit) {
+            max_deficit = deficit;
+            neediest = i;
+        }
+    }
+    return neediest;
+}
+
+
+// expects the lock to be held
+// returns false if the pool has already reached its target
+// pools below min_target_hints are never generated for, so they keep every instance that happens to reach them
+bool store_instance(Daemon* daemon, uint32_t pool_index, const char* instance) {
+    Pool* pool = daemon->pools + pool_index;
+    uint32_t limit = DAEMON_MIN_HINTS + pool_index < daemon->config.min_target_hints ? daemon->config.pool_capacity : pool_target(daemon, pool_index);
+    if (pool->size >= limit)
+        return false;
+    memcpy(pool->instances + pool->size * SUDOKUGEN_CHARS_PER_INSTANCE, instance, SUDOKUGEN_CHARS_PER_INSTANCE);
+    ++pool->size;
+    return true;
+}
+
+
+typedef struct {
+    Daemon* daemon;
+    // owned by daemon_run, which cancels it on shutdown
+    SudokuGenContext* context;
+    // for topping up instances
+    uint64_t seed;
+} GeneratorArgs;
+
+void* generator_thread(void* raw_args) {
+    GeneratorArgs* args = (GeneratorArgs*) raw_args;
+    Daemon* daemon = args->daemon;
+    SudokuGenContext* context = args->context;
+    Rng rng;
+    rng_seed(&rng, args->seed);
+
+    SudokuGenConfig config = sudokugen_default_config();
+    config.strategy = SUDOKUGEN_TIME_BOUNDED;
+
+    char instance[SUDOKUGEN_CHARS_PER_INSTANCE];
+
+    pthread_mutex_lock(&daemon->lock);
+    while (!shutdown_requested) {
+        update_rates(daemon);
+        uint32_t pool_index = neediest_pool(daemon);
+        if (pool_index == NUM_POOLS) {
+            // wake up regularly to keep the rates up to date
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_sec += 1;
+            pthread_cond_timedwait(&daemon->demand, &daemon->lock, &timeout);
+            continue;
+        }
+        config.max_seconds = daemon->pools[pool_index].seconds_per_instance;
+        pthread_mutex_unlock(&daemon->lock);
+
+        sudokugen_configure(context, &config);
+        uint32_t generated = sudokugen_generate(context, instance, 1);
+        if (!generated) {
+            pthread_mutex_lock(&daemon->lock);
+            continue;
+        }
+        uint32_t hints = 0;
+        for (uint32_t i = 0; i < SUDOKUGEN_CHARS_PER_INSTANCE; ++i) {
+            hints += instance[i] != '0';
+        }
+        // the search rarely ends above about 27 hints, so pools above that are filled by putting back hints of the solution
+        char topped_up[SUDOKUGEN_CHARS_PER_INSTANCE];
+        bool has_topped_up = false;
+        if (hints < DAEMON_MIN_HINTS + pool_index) {
+            Sudoku s;
+            sudoku_from_string(&s, instance);
+            Sudoku solution = s;
+            sudoku_solve(&solution);
+            has_topped_up = add_hints_from_solution(&s, &solution, config.symmetry, DAEMON_MIN_HINTS + pool_index, &rng);
+            sudoku_to_string(&s, topped_up);
+        }
+        pthread_mutex_lock(&daemon->lock);
+
+        // spend more time on pools that are hard to reach, less on those that are reached easily
+        Pool* target_pool = daemon->pools + pool_index;
+        if (hints > DAEMON_MIN_HINTS + pool_index) {
+            target_pool->seconds_per_instance *= 1.5f;
+            if (target_pool->seconds_per_instance > daemon->config.max_seconds_per_instance)
+                target_pool->seconds_per_instance = daemon->config.max_seconds_per_instance;
+        } else {
+            target_pool->seconds_per_instance *= 0.9f;
+            if (target_pool->seconds_per_instance < daemon->config.min_seconds_per_instance)
+                target_pool->seconds_per_instance = daemon->config.min_seconds_per_instance;
+        }
+        // the instance also serves every request with a higher bound, so it goes to its own pool while that one is short
+        // otherwise the topped up instance goes to the targeted pool, pools that have reached their target take nothing
+        if (hints >= DAEMON_MIN_HINTS && hints <= DAEMON_MAX_HINTS && store_instance(daemon, hints - DAEMON_MIN_HINTS, instance))
+            continue;
+        if (has_topped_up)
+            store_instance(daemon, pool_index, topped_up);
+    }
+    --daemon->running_generators;
+    pthread_mutex_unlock(&daemon->lock);
+    return NULL;
+}
+
+
+// takes up to count instances with at most max_hints hints, preferring instances close to max_hints
+// writes them as lines to out and returns the number of instances
+uint32_t serve_request(Daemon* daemon, uint32_t count, uint32_t max_hints, char* out) {
+    if (max_hints < DAEMON_MIN_HINTS)
+        return 0;
+    if (max_hints > DAEMON_MAX_HINTS)
+        max_hints = DAEMON_MAX_HINTS;
+
+    uint32_t served = 0;
+    pthread_mutex_lock(&daemon->lock);
+    for (uint32_t hints = max_hints; hints >= DAEMON_MIN_HINTS && served < count; --hints) {
+        Pool* pool = daemon->pools + (hints - DAEMON_MIN_HINTS);
+        // consumption is charged to the pools actually drained, so their refill rates follow it
+        uint32_t taken = 0;
+        while (pool->size > 0 && served < count) {
+            --pool->size;
+            memcpy(out + served * LINE_LENGTH, pool->instances + pool->size * SUDOKUGEN_CHARS_PER_INSTANCE, SUDOKUGEN_CHARS_PER_INSTANCE);
+            out[served * LINE_LENGTH + SUDOKUGEN_CHARS_PER_INSTANCE] = '\n';
+            ++served;
+            ++taken;
+        }
+        pool->requested_since_update += taken;
+    }
+    // unmet demand goes to the pool of the requested bound, which can be filled by topping up
+    daemon->pools[max_hints - DAEMON_MIN_HINTS].requested_since_update += count - served;
+    pthread_cond_broadcast(&daemon->demand);
+    pthread_mutex_unlock(&daemon->lock);
+    return served;
+}
+
+
+bool write_all(int fd, const char* buffer, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, buffer, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buffer += written;
+        length -= (size_t) written;
+    }
+    return true;
+}
+
+
+typedef struct {
+    Daemon* daemon;
+    int fd;
+} ClientArgs;
+
+void* client_thread(void* raw_args) {
+    ClientArgs args = *(ClientArgs*) raw_args;
+    free(raw_args);
+
+    char* reply = malloc(DAEMON_MAX_REQUEST * LINE_LENGTH);
+    FILE* input = fdopen(dup(args.fd), "r");
+    if (!reply || !input) {
+        free(reply);
+        if (input) fclose(input);
+        close(args.fd);
+        return NULL;
+    }
+
+    char line[64];
+    while (fgets(line, sizeof(line), input)) {
+        unsigned long count, max_hints;
+        if (sscanf(line, "%lu %lu", &count, &max_hints) != 2) {
+            if (!write_all(args.fd, "error\n", 6)) break;
+            continue;
+        }
+        if (count > DAEMON_MAX_REQUEST)
+            count = DAEMON_MAX_REQUEST;
+        if (max_hints > 81)
+            max_hints = 81;
+
+        uint32_t served = serve_request(args.daemon, (uint32_t) count, (uint32_t) max_hints, reply);
+        char header[16];
+        int header_length = snprintf(header, sizeof(header), "%u\n", served);
+        if (!write_all(args.fd, header, (size_t) header_length) || !write_all(args.fd, reply, served * LINE_LENGTH))
+            break;
+    }
+
+    fclose(input);
+    close(args.fd);
+    free(reply);
+    return NULL;
+}
+
+
+void request_shutdown(int signum) {
+    (void) signum;
+    shutdown_requested = 1;
+}
+
+
+// a generator that starts an instance right after a cancel resets its flag, so cancel until all have returned
+void stop_generators(Daemon* daemon, GeneratorArgs* generator_args, uint32_t count) {
+    shutdown_requested = 1;
+    pthread_mutex_lock(&daemon->lock);
+    while (daemon->running_generators > 0) {
+        for (uint32_t i = 0; i < count; ++i) {
+            sudokugen_cancel(generator_args[i].context);
+        }
+        pthread_cond_broadcast(&daemon->demand);
+        pthread_mutex_unlock(&daemon->lock);
+        struct timespec pause = {0, 10000000};
+        nanosleep(&pause, NULL);
+        pthread_mutex_lock(&daemon->lock);
+    }
+    pthread_mutex_unlock(&daemon->lock);
+}
+
+
+void destroy_generators(GeneratorArgs* generator_args, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        sudokugen_destroy(generator_args[i].context);
+    }
+}
+
+
+int daemon_run(const DaemonConfig* config) {
+    Daemon* daemon = calloc(1, sizeof(Daemon));
+    if (!daemon)
+        return 1;
+    daemon->config = *config;
+    daemon->last_rate_update = monotonic_seconds();
+    pthread_mutex_init(&daemon->lock, NULL);
+    pthread_cond_init(&daemon->demand, NULL);
+
+    char* storage = malloc((size_t) NUM_POOLS * config->pool_capacity * SUDOKUGEN_CHARS_PER_INSTANCE);
+    if (!storage) {
+        free(daemon);
+        return 1;
+    }
+    for (uint32_t i = 0; i < NUM_POOLS; ++i) {
+        daemon->pools[i].instances = storage + (size_t) i * config->pool_capacity * SUDOKUGEN_CHARS_PER_INSTANCE;
+        daemon->pools[i].seconds_per_instance = 0.1f;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, config->socket_path, sizeof(address.sun_path) - 1);
+    unlink(config->socket_path);
+    if (listener < 0 || bind(listener, (struct sockaddr*) &address, sizeof(address)) < 0 || listen(listener, 64) < 0) {
+        perror("gensudoku daemon");
+        if (listener >= 0) close(listener);
+        free(storage);
+        free(daemon);
+        return 1;
+    }
+
+    // accept() has to return on a signal, so do not restart it
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_shutdown;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_t* generators = malloc(config->num_threads * sizeof(pthread_t));
+    GeneratorArgs* generator_args = malloc(config->num_threads * sizeof(GeneratorArgs));
+    SudokuGenConfig generation = sudokugen_default_config();
+    uint64_t base_seed = (uint64_t) time(NULL);
+    uint32_t contexts = 0;
+    for (; generators && generator_args && contexts < config->num_threads; ++contexts) {
+        generator_args[contexts].daemon = daemon;
+        generator_args[contexts].context = sudokugen_create(&generation, base_seed + contexts);
+        generator_args[contexts].seed = base_seed + config->num_threads + contexts;
+        if (!generator_args[contexts].context)
+            break;
+    }
+    uint32_t started = 0;
+    if (contexts == config->num_threads) {
+        for (; started < config->num_threads; ++started) {
+            pthread_mutex_lock(&daemon->lock);
+            ++daemon->running_generators;
+            pthread_mutex_unlock(&daemon->lock);
+            if (pthread_create(generators + started, NULL, generator_thread, generator_args + started) != 0) {
+                pthread_mutex_lock(&daemon->lock);
+                --daemon->running_generators;
+                pthread_mutex_unlock(&daemon->lock);
+                break;
+            }
+        }
+    }
+    if (started < config->num_threads) {
+        fprintf(stderr, "gensudoku daemon: could not start %u generator threads\n", config->num_threads);
+        if (generator_args) {
+            stop_generators(daemon, generator_args, started);
+            for (uint32_t i = 0; i < started; ++i) {
+                pthread_join(generators[i], NULL);
+            }
+            destroy_generators(generator_args, contexts);
+        }
+        close(listener);
+        unlink(config->socket_path);
+        free(generators);
+        free(generator_args);
+        free(storage);
+        free(daemon);
+        return 1;
+    }
+
+    while (!shutdown_requested) {
+        int client = accept(listener, NULL, NULL);
+        if (client < 0)
+            continue;
+        ClientArgs* args = malloc(sizeof(ClientArgs));
+        pthread_t thread;
+        if (!args) {
+            close(client);
+            continue;
+        }
+        args->daemon = daemon;
+        args->fd = client;
+        if (pthread_create(&thread, NULL, client_thread, args) != 0) {
+            free(args);
+            close(client);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    close(listener);
+    unlink(config->socket_path);
+
+    // searches in progress end early instead of using up their time
+    stop_generators(daemon, generator_args, config->num_threads);
+    for (uint32_t i = 0; i < config->num_threads; ++i) {
+        pthread_join(generators[i], NULL);
+    }
+    destroy_generators(generator_args, config->num_threads);
+
+    // client threads are detached and may still hold the daemon, so it is left to process exit
+    free(generators);
+    free(generator_args);
+    return 0;
+}
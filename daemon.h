@@ -0,0 +1,43 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdint.h>
+
+// long-running puzzle server
+// keeps one pool of puzzles per hint count, refilled by background generator threads
+// pools above the hint counts the search ends at are filled by putting back hints of the solution
+// generator threads stop once every pool has reached its target and wait for requests
+// clients connect to a unix domain socket and send requests of the form "<count> <max_hints>\n"
+// the reply is a line "<n>\n" followed by n <= count instances (one per line) with at most max_hints hints
+// requests never block on generation, n is lower than count if the pools cannot satisfy the request right now
+
+#define DAEMON_MIN_HINTS 17u
+#define DAEMON_MAX_HINTS 40u
+#define DAEMON_MAX_REQUEST 1024u
+
+typedef struct {
+    const char* socket_path;
+    uint32_t num_threads;
+    // maximum number of instances per hint count
+    uint32_t pool_capacity;
+    // stock kept in every pool of at least min_fill_hints hints, regardless of demand
+    uint32_t min_fill;
+    uint32_t min_fill_hints;
+    // pools below this hint count are too expensive to fill on purpose
+    // they only receive instances that happen to turn out better than targeted
+    // must be at least DAEMON_MIN_HINTS
+    uint32_t min_target_hints;
+    // stock is sized to cover the observed consumption rate over this many seconds
+    float refill_horizon_seconds;
+    // bounds for the per-pool time budget, which adapts to how hard a pool is to fill
+    float min_seconds_per_instance;
+    float max_seconds_per_instance;
+} DaemonConfig;
+
+DaemonConfig daemon_default_config();
+
+// returns only after SIGINT or SIGTERM, or if the socket could not be set up
+// returns 0 on a clean shutdown
+int daemon_run(const DaemonConfig* config);
+
+#endif
@@ -21,6 +21,27 @@ void ofs_find_nonempty_fields(OrderedFieldSubset* fields, Sudoku* s) {
 }
 
 
+// stable partition of the index range [offset, size): selected fields are moved to the front
+// returns the number of selected fields
+uint32_t ofs_partition(OrderedFieldSubset* fields, uint32_t offset, FieldSubset* selected) {
+    uint32_t rejected[81];
+    uint32_t rejected_count = 0;
+    uint32_t selected_count = 0;
+    for (uint32_t i = offset; i < fields->size; ++i) {
+        uint32_t index = fields->indices[i];
+        if (fs_get_field(selected, index)) {
+            fields->indices[offset + selected_count++] = index;
+        } else {
+            rejected[rejected_count++] = index;
+        }
+    }
+    for (uint32_t i = 0; i < rejected_count; ++i) {
+        fields->indices[offset + selected_count + i] = rejected[i];
+    }
+    return selected_count;
+}
+
+
 bool fs_get_field(FieldSubset* fields, uint32_t index) {
     return fields->bits[index >> 5u] & (1 << (index & 0x1fu));
 }
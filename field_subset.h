@@ -19,6 +19,8 @@ typedef struct {
     uint32_t bits[3];
 } FieldSubset;
 
+uint32_t ofs_partition(OrderedFieldSubset* fields, uint32_t offset, FieldSubset* selected);
+
 bool fs_get_field(FieldSubset* fields, uint32_t index);
 void fs_set_field(FieldSubset* fields, uint32_t index);
 void fs_reset_field(FieldSubset* fields, uint32_t index);
@@ -1,187 +1,459 @@
 #include "generator.h"
 #include "utils.h"
 #include "field_subset.h"
-
+#include "batch_solver.h"
+#include "removal_search.h"
+#include "hint_state.h"
+#include "solution_count.h"
+#include "units.h"
+#include "trace.h"
+
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <time.h>
 
 
+static THREAD_LOCAL UniquenessStats uniqueness_counts;
+
+
+UniquenessStats uniqueness_stats() {
+    return uniqueness_counts;
+}
+
+
+void uniqueness_reset_stats() {
+    UniquenessStats zero = {0, 0, 0};
+    uniqueness_counts = zero;
+}
+
+
+void count_check(CheckTier tier) {
+    switch (tier) {
+        case CHECK_PROPAGATION:
+            ++uniqueness_counts.propagation;
+            break;
+        case CHECK_PROBE:
+            ++uniqueness_counts.probe;
+            break;
+        case CHECK_SEARCH:
+        default:
+            ++uniqueness_counts.search;
+            break;
+    }
+}
+
+
+// propagates the candidates of the field one by one into probes, in increasing order
+// returns the number of probes that survive propagation, solved is set to the number that fill the grid
+uint32_t probe_field(const Sudoku *s, uint32_t field, Sudoku probes[9], uint32_t *solved) {
+    uint32_t survivors = 0;
+    *solved = 0;
+    uint32_t candidates = s->data[field] >> SHIFT;
+    while (candidates) {
+        uint32_t candidate = candidates & -candidates;
+        candidates &= ~candidate;
+        Sudoku* probe = probes + survivors;
+        *probe = *s;
+        sudoku_put_one_hot_value(probe, field, candidate);
+        if (!sudoku_propagate(probe))
+            continue;
+        *solved += probe->blank_fields == 0;
+        ++survivors;
+    }
+    return survivors;
+}
+
+
+// tier 1: propagation, an instance it fills in has a single solution
+// tier 2: propagate each candidate of the field with the fewest, a candidate that alone survives is forced
+// and propagation resumes, two candidates that both fill the grid are two solutions
+// tier 3: a forward search from the first surviving probe and a reverse search from the last one,
+// which find the same solution iff it is unique, the probes spare the searches their first branch
+// contradictions that propagation misses only send a check to the next tier
 bool uniquely_solvable(Sudoku *s) {
+    TRACE_BEGIN(span);
     Sudoku copy = *s;
-    sudoku_solve(&copy);
-    Sudoku rcopy = *s;
-    sudoku_solve_reverse(&rcopy);
-    return sudoku_equal_values(&copy, &rcopy);
+    Sudoku probes[9];
+    CheckTier tier = CHECK_PROPAGATION;
+    bool unique = false;
+    while (true) {
+        if (!sudoku_propagate(&copy))
+            break;
+        if (copy.blank_fields == 0) {
+            unique = true;
+            break;
+        }
+
+        tier = CHECK_PROBE;
+        uint32_t solved;
+        uint32_t survivors = probe_field(&copy, branch_field(&copy), probes, &solved);
+        if (survivors == 1) {
+            copy = probes[0];
+            continue;
+        }
+        if (survivors == 0 || solved >= 2)
+            break;
+
+        tier = CHECK_SEARCH;
+        Sudoku forward;
+        uint32_t first = 0, last = survivors;
+        while (first < survivors) {
+            forward = probes[first];
+            if (sudoku_solve(&forward))
+                break;
+            ++first;
+        }
+        if (first == survivors)
+            break;
+        while (last > first + 1 && !sudoku_solve_reverse(probes + last - 1)) {
+            --last;
+        }
+        // solutions from two different probes differ in the field probed
+        if (last > first + 1)
+            break;
+        sudoku_solve_reverse(probes + first);
+        unique = sudoku_equal_values(&forward, probes + first);
+        break;
+    }
+    count_check(tier);
+    TRACE_END_SLOW(span, "uniqueness_check");
+    return unique;
+}
+
+
+// determine all hints of a uniquely solvable instance that can be cleared without losing uniqueness
+// a hint is removable iff no solution exists once it is cleared and its digit is excluded
+// this costs at most one solve per hint instead of the two solves of uniquely_solvable
+// all sibling checks are submitted to the batch solver at once
+// only hints contained in candidate_fields are checked, all other fields are reported as not removable
+FieldSubset find_removable_hints(const Sudoku *sudoku, const Sudoku *solution, FieldSubset *candidate_fields) {
+    TRACE_BEGIN(span);
+    FieldSubset removable;
+    fs_exclude_all_fields(&removable);
+
+    Sudoku pending[81];
+    uint32_t pending_fields[81];
+    uint32_t pending_count = 0;
+
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (!(sudoku->data[i] & LOWER) || !fs_get_field(candidate_fields, i))
+            continue;
+
+        uint32_t value = solution->data[i] & LOWER;
+        Sudoku* copy = pending + pending_count;
+        *copy = *sudoku;
+        sudoku_clear_field(copy, i);
+
+        // the hint is implied by its neighbors, no search required
+        if (!((copy->data[i] >> SHIFT) & ~value)) {
+            fs_set_field(&removable, i);
+            ++uniqueness_counts.propagation;
+            continue;
+        }
+
+        sudoku_exclude_one_hot_candidate(copy, i, value);
+        pending_fields[pending_count++] = i;
+    }
+
+    bool has_solution[81];
+    CheckTier tiers[81];
+    sudoku_has_solution_batch(pending, pending_count, has_solution, tiers);
+    for (uint32_t k = 0; k < pending_count; ++k) {
+        count_check(tiers[k]);
+        if (!has_solution[k]) {
+            fs_set_field(&removable, pending_fields[k]);
+        }
+    }
+    TRACE_END_SLOW(span, "removability_checks");
+    return removable;
+}
+
+
+// same as find_removable_hints, but for whole orbits represented by the fields in candidate_fields
+// an orbit is removable iff no solution exists once all its hints are cleared and the digit of any one of them is excluded
+// every field belongs to a single orbit, so there are still at most 81 checks
+FieldSubset find_removable_orbits(const Sudoku *sudoku, const Sudoku *solution, FieldSubset *candidate_fields, Symmetry symmetry) {
+    if (symmetry == SYMMETRY_NONE)
+        return find_removable_hints(sudoku, solution, candidate_fields);
+
+    TRACE_BEGIN(span);
+    FieldSubset removable;
+    fs_exclude_all_fields(&removable);
+
+    Sudoku pending[81];
+    uint32_t pending_orbits[81];
+    uint32_t pending_count = 0;
+
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (!(sudoku->data[i] & LOWER) || !fs_get_field(candidate_fields, i))
+            continue;
+
+        Sudoku cleared = *sudoku;
+        sudoku_clear_orbit(&cleared, symmetry, i);
+        fs_set_field(&removable, i);
+
+        uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+        uint32_t orbit_size = symmetry_orbit(symmetry, i, orbit);
+        for (uint32_t k = 0; k < orbit_size; ++k) {
+            uint32_t value = solution->data[orbit[k]] & LOWER;
+            // the hint is implied by its neighbors, no search required
+            if (!((cleared.data[orbit[k]] >> SHIFT) & ~value)) {
+                ++uniqueness_counts.propagation;
+                continue;
+            }
+            Sudoku* copy = pending + pending_count;
+            *copy = cleared;
+            sudoku_exclude_one_hot_candidate(copy, orbit[k], value);
+            pending_orbits[pending_count++] = i;
+        }
+    }
+
+    bool has_solution[81];
+    CheckTier tiers[81];
+    sudoku_has_solution_batch(pending, pending_count, has_solution, tiers);
+    for (uint32_t k = 0; k < pending_count; ++k) {
+        count_check(tiers[k]);
+        if (has_solution[k]) {
+            fs_reset_field(&removable, pending_orbits[k]);
+        }
+    }
+    TRACE_END_SLOW(span, "removability_checks");
+    return removable;
 }
 
 
 // generate instances by selecting and clearing fields from a solved instance
 // naive strategy: remove fields until the instance is not uniquely solvable, then terminate
-Sudoku generate_sudoku_naive() {
-    Sudoku out = sudoku_new_empty();
-    sudoku_solve_random(&out);
-    while (true) {
+Sudoku remove_hints_naive(const Sudoku *solution, Symmetry symmetry, SearchBudget *budget, Rng *rng) {
+    Sudoku out = *solution;
+    while (budget_spend_node(budget)) {
         // select any nonempty field
         OrderedFieldSubset nonempty_fields;
-        ofs_find_nonempty_fields(&nonempty_fields, &out);
-        uint32_t index = nonempty_fields.indices[random(0, nonempty_fields.size)];
-        uint32_t value = out.data[index];
+        ofs_find_nonempty_orbits(&nonempty_fields, &out, symmetry);
+        if (nonempty_fields.size == 0)
+            return out;
+        uint32_t index = nonempty_fields.indices[rng_range(rng, 0, nonempty_fields.size)];
 
         // delete field
-        sudoku_clear_field(&out, index);
+        sudoku_clear_orbit(&out, symmetry, index);
 
         // if not unique, put value pack and return board
+        budget_spend_checks(budget, 1);
         if (!uniquely_solvable(&out)) {
-            sudoku_put_one_hot_value(&out, index, value);
+            sudoku_restore_orbit(&out, solution, symmetry, index);
             return out;
         }
     }
+    return out;
+}
+
+
+Sudoku generate_sudoku_naive(Rng *rng) {
+    Sudoku solution = sudoku_new_empty();
+    sudoku_solve_random(&solution, rng);
+    SearchBudget budget;
+    budget_init(&budget);
+    return remove_hints_naive(&solution, SYMMETRY_NONE, &budget, rng);
 }
 
 
 // generate instances by selecting and clearing fields from a solved instance
-// las vegas strategy: random exhaustive search
+// las vegas strategy: random exhaustive search, see removal_search.h
 // enumerate all possible removal paths in a random order
-// prune path as soon as the instance is not uniquely solvable
 // return once a sufficiently good solution has been found
-bool try_remove_exhaustive(Sudoku *sudoku, OrderedFieldSubset *shuffled_fields, uint32_t index_index, uint32_t target_hints, OrderHeuristic heuristic, void* state) {
-    uint32_t current_hints = 81 - sudoku->blank_fields;
-
-    if (current_hints <= target_hints)
-        return true;
-
-    if (index_index >= shuffled_fields->size)
-        return false;
-
-    heuristic(shuffled_fields, index_index, 81 - index_index, sudoku, 1, state);
-
-    uint32_t index = shuffled_fields->indices[index_index];
-    uint32_t value = sudoku->data[index];
-
-    // remove the field, advance if the puzzle has a unique solution
-    sudoku_clear_field(sudoku, index);
-    if (uniquely_solvable(sudoku) && try_remove_exhaustive(sudoku, shuffled_fields, index_index + 1, target_hints, heuristic, state)) {
-        return true;
-    }
-    // reinsert value
-    sudoku_put_one_hot_value(sudoku, index, value);
-    // this effectively loops over all fields starting with index_index
-    return try_remove_exhaustive(sudoku, shuffled_fields, index_index + 1, target_hints, heuristic, state);
+// if the budget is exhausted first, the solution is returned
+Sudoku remove_hints_exhaustive(const Sudoku *solution, Symmetry symmetry, uint32_t max_hints, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng) {
+    RemovalSearch search;
+    removal_search_init_exhaustive(&search, solution, symmetry, max_hints, rng);
+    if (removal_search_run(&search, budget, heuristic, state, NULL) != REMOVAL_FOUND)
+        return *solution;
+    return removal_search_result(&search);
 }
 
 
-Sudoku generate_sudoku_with_min_hints_exhaustive(uint32_t max_hints, OrderHeuristic heuristic, void* state) {
-    Sudoku out = sudoku_new_empty();
-    sudoku_solve_random(&out);
-
-    OrderedFieldSubset all_fields;
-    ofs_set_identity(&all_fields);
-    // generate a random traversal order in the beginning and move left-to-right only!
-    // this is sufficient because (remove field 1 then 2) == (remove field 2 then 1)
-    random_shuffle(all_fields.indices, all_fields.size);
-
-    try_remove_exhaustive(&out, &all_fields, 0, max_hints, heuristic, state);
-
-    return out;
+Sudoku generate_sudoku_with_min_hints_exhaustive(uint32_t max_hints, OrderHeuristic heuristic, void* state, Rng *rng) {
+    Sudoku solution = sudoku_new_empty();
+    sudoku_solve_random(&solution, rng);
+    SearchBudget budget;
+    budget_init(&budget);
+    return remove_hints_exhaustive(&solution, SYMMETRY_NONE, max_hints, &budget, heuristic, state, rng);
 }
 
 
 // generate instances by selecting and clearing fields from a solved instance
 // monte carlo strategy: random bounded search
 // generate only a limited number of removal candidates per field, try all of them
-// prune path as soon as the instance is not uniquely solvable
+// only expand hints that are removable, i.e. the instance stays uniquely solvable
 // return the instance with the least candidates among all paths
-void try_remove_bounded(Sudoku *sudoku, OrderedFieldSubset *shuffled_fields, uint32_t index_index, uint32_t max_attempts_per_field, Sudoku *best_so_far, OrderHeuristic heuristic, void* state) {
+void try_remove_bounded(Sudoku *sudoku, const Sudoku *solution, Symmetry symmetry, OrderedFieldSubset *shuffled_fields, uint32_t index_index, FieldSubset removable, uint32_t max_attempts_per_field, HintState *best_so_far, SearchBudget *budget, OrderHeuristic heuristic, void* state) {
 
-    if (sudoku->blank_fields > best_so_far->blank_fields) {
-        *best_so_far = *sudoku;
+    if (81 - sudoku->blank_fields < best_so_far->hint_count) {
+        hint_state_from_sudoku(best_so_far, sudoku);
     }
+    if (!budget_spend_node(budget))
+        return;
 
     // only try removing the next max_attempts many fields starting from index_index
     for (uint32_t attempt = 0; attempt < max_attempts_per_field; ++attempt) {
 
         uint32_t shifted_index_index = index_index + attempt;
 
-        if (shifted_index_index >= shuffled_fields->size)
+        // deeper levels reorder the fields, so the removable ones need to be moved to the front again
+        uint32_t removable_count = ofs_partition(shuffled_fields, index_index, &removable);
+        if (attempt >= removable_count)
+            break;
+        // branch and bound: the subtrees of this and all further attempts can at most clear the remaining removable hints
+        uint32_t bound = sudoku->blank_fields + ofs_count_orbit_fields(shuffled_fields, shifted_index_index, removable_count - attempt, symmetry);
+        if (81 - min(bound, 81 - MIN_UNIQUE_HINTS) >= best_so_far->hint_count)
             break;
 
-        heuristic(shuffled_fields, index_index, 81 - index_index, sudoku, 1, state);
+        TRACE_BEGIN(heuristic_span);
+        heuristic(shuffled_fields, index_index, removable_count, sudoku, 1, state);
+        TRACE_END(heuristic_span, "heuristic");
 
         uint32_t index = shuffled_fields->indices[shifted_index_index];
-        uint32_t value = sudoku->data[index];
 
-        sudoku_clear_field(sudoku, index);
-        if (uniquely_solvable(sudoku)) {
-            try_remove_bounded(sudoku, shuffled_fields, shifted_index_index + 1, max_attempts_per_field, best_so_far, heuristic, state);
-        }
-        sudoku_put_one_hot_value(sudoku, index, value);
+        sudoku_clear_orbit(sudoku, symmetry, index);
+        budget_spend_checks(budget, fs_size(&removable));
+        FieldSubset next_removable = find_removable_orbits(sudoku, solution, &removable, symmetry);
+        try_remove_bounded(sudoku, solution, symmetry, shuffled_fields, shifted_index_index + 1, next_removable, max_attempts_per_field, best_so_far, budget, heuristic, state);
+        sudoku_restore_orbit(sudoku, solution, symmetry, index);
     }
 }
 
 
-Sudoku generate_sudoku_with_min_hints_bounded(uint32_t max_attempts_per_field, OrderHeuristic heuristic, void* state) {
-    Sudoku sudoku = sudoku_new_empty();
-    sudoku_solve_random(&sudoku);
-    Sudoku best = sudoku;
+Sudoku remove_hints_bounded(const Sudoku *solution, Symmetry symmetry, uint32_t max_attempts_per_field, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng) {
+    Sudoku sudoku = *solution;
+    HintState best;
+    hint_state_init_full(&best);
 
     OrderedFieldSubset all_fields;
-    ofs_set_identity(&all_fields);
-    random_shuffle(all_fields.indices, all_fields.size);
+    ofs_set_orbits(&all_fields, symmetry);
+    rng_shuffle(rng, all_fields.indices, all_fields.size);
 
-    try_remove_bounded(&sudoku, &all_fields, 0, max_attempts_per_field, &best, heuristic, state);
+    FieldSubset removable;
+    fs_exclude_all_fields(&removable);
+    fs_add_from_ifs(&removable, &all_fields);
 
-    return best;
+    TRACE_BEGIN(span);
+    try_remove_bounded(&sudoku, solution, symmetry, &all_fields, 0, removable, max_attempts_per_field, &best, budget, heuristic, state);
+    TRACE_END(span, "try_remove_bounded");
+
+    hint_state_materialize(&best, solution, &sudoku);
+    return sudoku;
+}
+
+
+Sudoku generate_sudoku_with_min_hints_bounded(uint32_t max_attempts_per_field, OrderHeuristic heuristic, void* state, Rng *rng) {
+    Sudoku solution = sudoku_new_empty();
+    sudoku_solve_random(&solution, rng);
+    SearchBudget budget;
+    budget_init(&budget);
+    return remove_hints_bounded(&solution, SYMMETRY_NONE, max_attempts_per_field, &budget, heuristic, state, rng);
 }
 
 
 // generate instances by selecting and clearing fields from a solved instance
-// monte carlo strategy: random time-bounded search
-// prune path as soon as the instance is not uniquely solvable
-// take the instance with the least candidates after a set time limit
-// returns true if the time limit was reached
-bool try_remove_time_bounded(Sudoku *sudoku, OrderedFieldSubset *shuffled_fields, uint32_t index_index, clock_t start, float max_seconds, Sudoku *best_so_far, OrderHeuristic heuristic, void* state) {
-
-    if (sudoku->blank_fields > best_so_far->blank_fields) {
-        *best_so_far = *sudoku;
-    }
+// monte carlo strategy: random time-bounded search, see removal_search.h
+// take the instance with the least candidates once the budget is used up, or the whole search space is
+Sudoku remove_hints_time_bounded(const Sudoku *solution, Symmetry symmetry, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng) {
+    RemovalSearch search;
+    removal_search_init_time_bounded(&search, solution, symmetry, rng);
+    removal_search_run(&search, budget, heuristic, state, NULL);
+    return removal_search_result(&search);
+}
 
-    clock_t current = clock();
-    float seconds = (float) (current - start) / CLOCKS_PER_SEC;
-    if (seconds > max_seconds)
-        return true;
 
-    if (index_index >= shuffled_fields->size)
-        return false;
+bool add_hints_from_solution(Sudoku *sudoku, const Sudoku *solution, Symmetry symmetry, uint32_t hints, Rng *rng) {
+    OrderedFieldSubset orbits;
+    ofs_set_orbits(&orbits, symmetry);
+    rng_shuffle(rng, orbits.indices, orbits.size);
 
-    heuristic(shuffled_fields, index_index, 81 - index_index, sudoku, 1, state);
+    // orbits larger than the remaining deficit are skipped, smaller ones further back may still fit
+    uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+    for (uint32_t i = 0; i < orbits.size && 81 - sudoku->blank_fields < hints; ++i) {
+        uint32_t field = orbits.indices[i];
+        if (sudoku->data[field] & LOWER)
+            continue;
+        if (symmetry_orbit(symmetry, field, orbit) <= hints - (81 - sudoku->blank_fields))
+            sudoku_restore_orbit(sudoku, solution, symmetry, field);
+    }
+    return 81 - sudoku->blank_fields == hints;
+}
+
+
+RestartSchedule restart_default_schedule() {
+    RestartSchedule schedule;
+    schedule.policy = RESTART_LUBY;
+    schedule.unit_checks = 4096;
+    schedule.growth = 1.5;
+    return schedule;
+}
 
-    uint32_t index = shuffled_fields->indices[index_index];
-    uint32_t value = sudoku->data[index];
 
-    // remove the field, advance if the puzzle has a unique solution
-    sudoku_clear_field(sudoku, index);
-    if (uniquely_solvable(sudoku) && try_remove_time_bounded(sudoku, shuffled_fields, index_index + 1, start, max_seconds, best_so_far, heuristic, state)) {
-        return true;
+// luby sequence, run counting from 0
+uint64_t luby(uint64_t run) {
+    uint64_t i = run + 1;
+    while (true) {
+        // smallest k with i <= 2^k - 1
+        uint32_t k = 1;
+        while (((uint64_t) 1 << k) - 1 < i) {
+            ++k;
+        }
+        if (i == ((uint64_t) 1 << k) - 1)
+            return (uint64_t) 1 << (k - 1);
+        i -= ((uint64_t) 1 << (k - 1)) - 1;
     }
-    // reinsert value
-    sudoku_put_one_hot_value(sudoku, index, value);
-    // this effectively loops over all fields starting with index_index
-    return try_remove_time_bounded(sudoku, shuffled_fields, index_index + 1, start, max_seconds, best_so_far, heuristic, state);
 }
 
 
-Sudoku generate_sudoku_with_min_hints_time_bounded(float max_seconds, OrderHeuristic heuristic, void* state) {
-    Sudoku sudoku = sudoku_new_empty();
-    sudoku_solve_random(&sudoku);
-    Sudoku best = sudoku;
+uint64_t restart_run_checks(const RestartSchedule *schedule, uint32_t run) {
+    uint64_t unit = schedule->unit_checks ? schedule->unit_checks : 1;
+    switch (schedule->policy) {
+        case RESTART_LUBY:
+            return unit * luby(run);
+        case RESTART_GEOMETRIC: {
+            double checks = (double) unit * pow(schedule->growth, run);
+            return checks < 1e18 ? (uint64_t) checks : UINT64_MAX;
+        }
+        case RESTART_NONE:
+        default:
+            return UINT64_MAX;
+    }
+}
 
-    OrderedFieldSubset all_fields;
-    ofs_set_identity(&all_fields);
-    random_shuffle(all_fields.indices, all_fields.size);
 
-    clock_t start = clock();
-    try_remove_time_bounded(&sudoku, &all_fields, 0, start, max_seconds, &best, heuristic, state);
+// the runs are time-bounded searches with a slice of the budget each
+// a run also ends early if it explores its whole search space
+Sudoku remove_hints_with_restarts(const Sudoku *solution, Symmetry symmetry, const RestartSchedule *schedule, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng) {
+    Sudoku grid = *solution;
+    Sudoku best = grid;
+    for (uint32_t run = 0; ; ++run) {
+        if (run > 0) {
+            grid = sudoku_new_empty();
+            sudoku_solve_random(&grid, rng);
+        }
+        SearchBudget slice;
+        budget_slice(budget, restart_run_checks(schedule, run), &slice);
+        RemovalSearch search;
+        removal_search_init_time_bounded(&search, &grid, symmetry, rng);
+        removal_search_run(&search, &slice, heuristic, state, NULL);
+        Sudoku result = removal_search_result(&search);
+        if (result.blank_fields > best.blank_fields) {
+            best = result;
+        }
+        if (!budget_merge_slice(budget, &slice))
+            return best;
+    }
+}
+
 
-    return best;
+Sudoku generate_sudoku_with_min_hints_time_bounded(float max_seconds, OrderHeuristic heuristic, void* state, Rng *rng) {
+    Sudoku solution = sudoku_new_empty();
+    sudoku_solve_random(&solution, rng);
+    SearchBudget budget;
+    budget_init(&budget);
+    budget_set_seconds(&budget, max_seconds);
+    RestartSchedule schedule = restart_default_schedule();
+    return remove_hints_with_restarts(&solution, SYMMETRY_NONE, &schedule, &budget, heuristic, state, rng);
 }
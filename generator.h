@@ -3,10 +3,73 @@
 
 #include "sudoku.h"
 #include "heuristics.h"
+#include "field_subset.h"
+#include "budget.h"
+#include "symmetry.h"
+#include "batch_solver.h"
 
-Sudoku generate_sudoku_naive();
-Sudoku generate_sudoku_with_min_hints_exhaustive(uint32_t max_hints, OrderHeuristic heuristic, void* state);
-Sudoku generate_sudoku_with_min_hints_bounded(uint32_t max_attempts_per_field, OrderHeuristic heuristic, void* state);
-Sudoku generate_sudoku_with_min_hints_time_bounded(float max_seconds, OrderHeuristic heuristic, void* state);
+// no instance with fewer hints has a unique solution (McGuire et al., 2012), which bounds every search
+#define MIN_UNIQUE_HINTS 17u
+
+// checks of the calling thread by the tier that decided them, see CheckTier in batch_solver.h
+// removability checks and uniqueness checks count alike, hints implied by their neighbors count as propagation
+typedef struct {
+    uint64_t propagation;
+    uint64_t probe;
+    uint64_t search;
+} UniquenessStats;
+
+UniquenessStats uniqueness_stats();
+void uniqueness_reset_stats();
+
+bool uniquely_solvable(Sudoku *s);
+FieldSubset find_removable_hints(const Sudoku *sudoku, const Sudoku *solution, FieldSubset *candidate_fields);
+// candidate_fields holds orbit representatives, see symmetry.h
+FieldSubset find_removable_orbits(const Sudoku *sudoku, const Sudoku *solution, FieldSubset *candidate_fields, Symmetry symmetry);
+
+// clear hints of a solved instance, the generate_* functions below call these on a random solution
+// every strategy stops early once the budget is exhausted, the time-bounded strategy only stops then
+// hints are cleared in orbits of the symmetry, so the instances keep it
+Sudoku remove_hints_naive(const Sudoku *solution, Symmetry symmetry, SearchBudget *budget, Rng *rng);
+Sudoku remove_hints_exhaustive(const Sudoku *solution, Symmetry symmetry, uint32_t max_hints, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng);
+Sudoku remove_hints_bounded(const Sudoku *solution, Symmetry symmetry, uint32_t max_attempts_per_field, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng);
+Sudoku remove_hints_time_bounded(const Sudoku *solution, Symmetry symmetry, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng);
+
+// puts hints of the solution back into random empty orbits until the instance has exactly the given number of hints
+// hints of its own solution never make a uniquely solvable instance ambiguous, so no checks are needed
+// returns false if no combination of the orbits tried adds up to the count, the instance then has fewer hints
+bool add_hints_from_solution(Sudoku *sudoku, const Sudoku *solution, Symmetry symmetry, uint32_t hints, Rng *rng);
+
+typedef enum {
+    RESTART_NONE,
+    // run lengths follow the luby sequence 1, 1, 2, 1, 1, 2, 4, 1, ... times unit_checks
+    RESTART_LUBY,
+    // run lengths grow by a constant factor, starting with unit_checks
+    RESTART_GEOMETRIC
+} RestartPolicy;
+
+typedef struct {
+    RestartPolicy policy;
+    // removability checks of the shortest run
+    uint64_t unit_checks;
+    // RESTART_GEOMETRIC only
+    double growth;
+} RestartSchedule;
+
+RestartSchedule restart_default_schedule();
+// removability checks of the given run, counting from 0
+uint64_t restart_run_checks(const RestartSchedule *schedule, uint32_t run);
+
+// time-bounded strategy that restarts the search according to the schedule, each time from a new random solution
+// the first run starts from the given solution, the instance with the most blank fields over all runs is returned
+// the budget has to be limited, since the restarts only end once it is exhausted
+Sudoku remove_hints_with_restarts(const Sudoku *solution, Symmetry symmetry, const RestartSchedule *schedule, SearchBudget *budget, OrderHeuristic heuristic, void* state, Rng *rng);
+
+// no symmetry and unlimited budgets, the time-bounded strategy uses a wall-clock deadline and the default restart schedule
+
+Sudoku generate_sudoku_naive(Rng *rng);
+Sudoku generate_sudoku_with_min_hints_exhaustive(uint32_t max_hints, OrderHeuristic heuristic, void* state, Rng *rng);
+Sudoku generate_sudoku_with_min_hints_bounded(uint32_t max_attempts_per_field, OrderHeuristic heuristic, void* state, Rng *rng);
+Sudoku generate_sudoku_with_min_hints_time_bounded(float max_seconds, OrderHeuristic heuristic, void* state, Rng *rng);
 
 #endif
@@ -1,6 +1,11 @@
 #include "heuristics.h"
+#include "units.h"
 #include "utils.h"
 
+#ifdef SUDOKUGEN_GENERATED_KERNELS
+#include "sudoku_kernels.h"
+#endif
+
 
 uint32_t no_heuristic(
         OrderedFieldSubset* candidate_fields,
@@ -15,6 +20,9 @@ uint32_t no_heuristic(
 
 
 uint32_t count_neighbors(const Sudoku *sudoku, uint32_t index) {
+#ifdef SUDOKUGEN_GENERATED_KERNELS
+    return kernel_count_neighbors(sudoku->data, index);
+#else
     uint32_t r = index / 9u * 9u, c = index % 9u, sq = index / 27u * 27u + c / 3u * 3u;
     uint32_t neighbors = 0;
     for (uint32_t i = 0; i < 9; ++i) {
@@ -27,6 +35,7 @@ uint32_t count_neighbors(const Sudoku *sudoku, uint32_t index) {
         }
     }
     return neighbors;
+#endif
 }
 
 
@@ -54,8 +63,8 @@ uint32_t max_neighbors_heuristic(
             break;
 
         if (neighbor_counts[i] == max) {
-            uint32_t temp = candidate_fields->indices[generated_candidates];
-            candidate_fields->indices[generated_candidates] = candidate_fields->indices[i];
+            uint32_t temp = candidate_fields->indices[candidate_offset + generated_candidates];
+            candidate_fields->indices[candidate_offset + generated_candidates] = candidate_fields->indices[i];
             candidate_fields->indices[i] = temp;
             ++generated_candidates;
         }
@@ -89,8 +98,8 @@ uint32_t min_neighbors_heuristic(
             break;
 
         if (neighbor_counts[i] == min) {
-            uint32_t temp = candidate_fields->indices[generated_candidates];
-            candidate_fields->indices[generated_candidates] = candidate_fields->indices[i];
+            uint32_t temp = candidate_fields->indices[candidate_offset + generated_candidates];
+            candidate_fields->indices[candidate_offset + generated_candidates] = candidate_fields->indices[i];
             candidate_fields->indices[i] = temp;
             ++generated_candidates;
         }
@@ -135,8 +144,8 @@ uint32_t most_frequent_digit_heuristic(
 
         uint32_t digit = sudoku_read_value(instance, candidate_fields->indices[i]);
         if (digit_counts[digit - 1] == max) {
-            uint32_t temp = candidate_fields->indices[generated_candidates];
-            candidate_fields->indices[generated_candidates] = candidate_fields->indices[i];
+            uint32_t temp = candidate_fields->indices[candidate_offset + generated_candidates];
+            candidate_fields->indices[candidate_offset + generated_candidates] = candidate_fields->indices[i];
             candidate_fields->indices[i] = temp;
             ++generated_candidates;
         }
@@ -181,8 +190,8 @@ uint32_t least_frequent_digit_heuristic(
 
         uint32_t digit = sudoku_read_value(instance, candidate_fields->indices[i]);
         if (digit_counts[digit - 1] == min) {
-            uint32_t temp = candidate_fields->indices[generated_candidates];
-            candidate_fields->indices[generated_candidates] = candidate_fields->indices[i];
+            uint32_t temp = candidate_fields->indices[candidate_offset + generated_candidates];
+            candidate_fields->indices[candidate_offset + generated_candidates] = candidate_fields->indices[i];
             candidate_fields->indices[i] = temp;
             ++generated_candidates;
         }
@@ -192,7 +201,133 @@ uint32_t least_frequent_digit_heuristic(
 }
 
 
+// the key of a built-in heuristic in the fused evaluation of a heuristic stack, higher keys are better
+typedef enum {
+    KEY_CONSTANT,
+    KEY_MAX_NEIGHBORS,
+    KEY_MIN_NEIGHBORS,
+    KEY_MOST_FREQUENT_DIGIT,
+    KEY_LEAST_FREQUENT_DIGIT,
+    KEY_UNKNOWN
+} HeuristicKey;
+
+// bits per stage of a packed key, neighbor counts go up to 27 and digit counts up to 9
+#define KEY_BITS 5u
+#define KEY_MASK 31u
+#define MAX_FUSED_STAGES 12u
+
+
+HeuristicKey heuristic_key(OrderHeuristic heuristic) {
+    if (heuristic == no_heuristic) return KEY_CONSTANT;
+    if (heuristic == max_neighbors_heuristic) return KEY_MAX_NEIGHBORS;
+    if (heuristic == min_neighbors_heuristic) return KEY_MIN_NEIGHBORS;
+    if (heuristic == most_frequent_digit_heuristic) return KEY_MOST_FREQUENT_DIGIT;
+    if (heuristic == least_frequent_digit_heuristic) return KEY_LEAST_FREQUENT_DIGIT;
+    return KEY_UNKNOWN;
+}
+
+
+// evaluates all stages at once, returns false if a stage is no built-in heuristic
+// a single pass over the grid counts the filled fields per unit and the digit frequencies, the neighbor count of a field
+// is the sum over its three units, and the keys of all stages are packed into one, the first stage in the highest bits
+// so that comparing packed keys compares the stages lexicographically
+// the candidates are then swapped to the front stage by stage exactly like the sequential evaluation does,
+// so that the remaining candidates end up in the same order and the instances do not change
+bool fused_combined_heuristic(
+        OrderedFieldSubset* candidate_fields,
+        uint32_t candidate_offset,
+        uint32_t candidate_count,
+        const Sudoku* instance,
+        uint32_t max_candidates_to_generate,
+        const CombinedHeuristic* heuristic_stack,
+        uint32_t* generated_candidates) {
+
+    uint32_t stage_count = heuristic_stack->count;
+    if (stage_count > MAX_FUSED_STAGES)
+        return false;
+    // every stage key is the constant 0, the neighbor count or the digit frequency, inverted for minimizing stages
+    uint32_t sources[MAX_FUSED_STAGES], inversions[MAX_FUSED_STAGES];
+    for (uint32_t s = 0; s < stage_count; ++s) {
+        HeuristicKey key = heuristic_key(heuristic_stack->heuristics[s]);
+        if (key == KEY_UNKNOWN)
+            return false;
+        sources[s] = key == KEY_CONSTANT ? 0 : key <= KEY_MIN_NEIGHBORS ? 1 : 2;
+        inversions[s] = key == KEY_MIN_NEIGHBORS || key == KEY_LEAST_FREQUENT_DIGIT ? KEY_MASK : 0;
+    }
+
+    // digits from 0 to 8, 9 for blank fields
+    uint32_t digit_counts[10];
+    for (uint32_t d = 0; d < 10u; ++d) {
+        digit_counts[d] = 0;
+    }
+    uint32_t digits[81], filled[81];
+    for (uint32_t i = 0; i < 81u; ++i) {
+        uint32_t value = instance->data[i] & LOWER;
+        digits[i] = lowest_set_bit_index(value | 0x200u);
+        ++digit_counts[digits[i]];
+        filled[i] = value != 0;
+    }
+    digit_counts[9] = 0;
+    uint32_t unit_filled[UNIT_COUNT];
+    for (uint32_t u = 0; u < UNIT_COUNT; ++u) {
+        uint32_t count = 0;
+        for (uint32_t k = 0; k < 9u; ++k) {
+            count += filled[UNIT_FIELDS[u][k]];
+        }
+        unit_filled[u] = count;
+    }
+
+    // packed keys by field, and the best among the candidates
+    uint64_t keys[81];
+    uint64_t best = 0;
+    for (uint32_t i = candidate_offset; i < candidate_offset + candidate_count; ++i) {
+        uint32_t field = candidate_fields->indices[i];
+        const uint8_t* units = FIELD_UNITS[field];
+        uint32_t values[3] = {
+                0,
+                unit_filled[units[0]] + unit_filled[units[1]] + unit_filled[units[2]],
+                digit_counts[digits[field]]
+        };
+        uint64_t key = 0;
+        for (uint32_t s = 0; s < stage_count; ++s) {
+            key = key << KEY_BITS | (values[sources[s]] ^ inversions[s]);
+        }
+        keys[field] = key;
+        if (key > best)
+            best = key;
+    }
+
+    // the candidates of stage s are those agreeing with the best key in the stages up to s
+    for (uint32_t s = 0; s < stage_count; ++s) {
+        uint32_t shift = KEY_BITS * (stage_count - 1 - s);
+        uint32_t local_max_candidates_to_generate = candidate_count;
+        if (s == stage_count - 1) {
+            local_max_candidates_to_generate = min(max_candidates_to_generate, local_max_candidates_to_generate);
+        }
+        uint32_t generated = 0;
+        for (uint32_t i = candidate_offset; i < candidate_offset + candidate_count; ++i) {
+            if (generated >= local_max_candidates_to_generate)
+                break;
+
+            if (keys[candidate_fields->indices[i]] >> shift == best >> shift) {
+                uint32_t temp = candidate_fields->indices[candidate_offset + generated];
+                candidate_fields->indices[candidate_offset + generated] = candidate_fields->indices[i];
+                candidate_fields->indices[i] = temp;
+                ++generated;
+            }
+        }
+        // ignore failed heuristics
+        if (generated == 0) continue;
+        candidate_count = generated;
+    }
+
+    *generated_candidates = min(max_candidates_to_generate, candidate_count);
+    return true;
+}
+
+
 // applies multiple heuristics in sequence
+// stacks of built-in heuristics are evaluated in a single pass, see fused_combined_heuristic
 uint32_t combined_heuristic(
         OrderedFieldSubset* candidate_fields,
         uint32_t candidate_offset,
@@ -203,6 +338,11 @@ uint32_t combined_heuristic(
 
     CombinedHeuristic* heuristic_stack = (CombinedHeuristic*) state;
 
+    uint32_t fused_candidates;
+    if (fused_combined_heuristic(candidate_fields, candidate_offset, candidate_count, instance,
+                                 max_candidates_to_generate, heuristic_stack, &fused_candidates))
+        return fused_candidates;
+
     for (uint32_t i = 0; i < heuristic_stack->count; ++i) {
         OrderHeuristic local_heuristic = heuristic_stack->heuristics[i];
         void* local_state = heuristic_stack->states[i];
@@ -34,6 +34,9 @@ DECLARE_HEURISTIC(most_frequent_digit_heuristic)
 DECLARE_HEURISTIC(least_frequent_digit_heuristic)
 DECLARE_HEURISTIC(combined_heuristic)
 
+// the state of combined_heuristic, applied first to last
+// stacks of the heuristics above are evaluated in one pass with lexicographic keys, in about the time of a single one,
+// and order the candidates exactly like applying them one by one; other heuristics are applied one by one
 typedef struct {
     OrderHeuristic* heuristics;
     void** states;
@@ -0,0 +1,66 @@
+#include "hint_state.h"
+#include "units.h"
+#include "utils.h"
+
+
+void hint_state_init_full(HintState* state) {
+    fs_exclude_all_fields(&state->hints);
+    for (uint32_t i = 0; i < 81u; ++i) {
+        fs_set_field(&state->hints, i);
+    }
+    state->hint_count = 81;
+}
+
+
+void hint_state_from_sudoku(HintState* state, const Sudoku* sudoku) {
+    fs_exclude_all_fields(&state->hints);
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (sudoku->data[i] & LOWER)
+            fs_set_field(&state->hints, i);
+    }
+    state->hint_count = 81 - sudoku->blank_fields;
+}
+
+
+void hint_state_clear_orbit(HintState* state, Symmetry symmetry, uint32_t field) {
+    uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+    uint32_t size = symmetry_orbit(symmetry, field, orbit);
+    for (uint32_t i = 0; i < size; ++i) {
+        fs_reset_field(&state->hints, orbit[i]);
+    }
+    state->hint_count -= size;
+}
+
+
+void hint_state_restore_orbit(HintState* state, Symmetry symmetry, uint32_t field) {
+    uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+    uint32_t size = symmetry_orbit(symmetry, field, orbit);
+    for (uint32_t i = 0; i < size; ++i) {
+        fs_set_field(&state->hints, orbit[i]);
+    }
+    state->hint_count += size;
+}
+
+
+// the candidates of a blank field are the digits none of its units holds, as recompute_adjacent in sudoku.c leaves them
+void hint_state_materialize(const HintState* state, const Sudoku* solution, Sudoku* out) {
+    for (uint32_t i = 0; i < 81u; ++i) {
+        uint32_t hint = state->hints.bits[i >> 5u] >> (i & 0x1fu) & 1u;
+        out->data[i] = solution->data[i] & LOWER & (0u - hint);
+    }
+    uint32_t placed[UNIT_COUNT];
+    for (uint32_t u = 0; u < UNIT_COUNT; ++u) {
+        uint32_t values = 0;
+        for (uint32_t k = 0; k < 9u; ++k) {
+            values |= out->data[UNIT_FIELDS[u][k]];
+        }
+        placed[u] = values;
+    }
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (out->data[i])
+            continue;
+        const uint8_t* units = FIELD_UNITS[i];
+        out->data[i] = (~(placed[units[0]] | placed[units[1]] | placed[units[2]]) & ALL_CANDIDATES) << SHIFT;
+    }
+    out->blank_fields = 81 - state->hint_count;
+}
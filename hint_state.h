@@ -0,0 +1,27 @@
+#ifndef HINT_STATE_H
+#define HINT_STATE_H
+
+#include "sudoku.h"
+#include "field_subset.h"
+#include "symmetry.h"
+
+#include <stdint.h>
+
+// the state of a hole-digging search: which fields of its solution are still hints
+// the solution never changes during a search, so 16 bytes describe an instance instead of the 328 of a Sudoku
+// clearing and restoring hints only flips bits, the Sudoku with candidates is materialized when a check needs it
+typedef struct {
+    FieldSubset hints;
+    uint32_t hint_count;
+} HintState;
+
+// every field a hint, i.e. the solution itself
+void hint_state_init_full(HintState* state);
+void hint_state_from_sudoku(HintState* state, const Sudoku* sudoku);
+void hint_state_clear_orbit(HintState* state, Symmetry symmetry, uint32_t field);
+void hint_state_restore_orbit(HintState* state, Symmetry symmetry, uint32_t field);
+// the hints of the solution with the candidates of all blank fields, the same Sudoku that clearing and restoring
+// the hints with sudoku_clear_field and sudoku_put_one_hot_value would have left
+void hint_state_materialize(const HintState* state, const Sudoku* solution, Sudoku* out);
+
+#endif
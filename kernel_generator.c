@@ -0,0 +1,134 @@
+#include "units.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// build step: writes sudoku_kernels.h, the unit and peer walks of sudoku.c and heuristics.c as straight-line code
+// every field and unit gets code of its own with all indices as constants, dispatched by a switch on the field
+// the kernels visit the same fields in the same order as the generic loops, so both produce identical instances
+// usage: kernel_generator <output path>
+
+
+uint32_t shares_unit(uint32_t field, uint32_t other) {
+    uint32_t shared = 0;
+    for (uint32_t t = 0; t < 3; ++t) {
+        shared += FIELD_UNITS[field][t] == FIELD_UNITS[other][t];
+    }
+    return shared;
+}
+
+
+// remove_adjacent: clears a candidate from all peers, mask keeps all other bits
+void write_remove_peer_candidates(FILE* out) {
+    fputs("static inline void kernel_remove_peer_candidates(uint32_t* data, uint32_t field, uint32_t mask) {\n", out);
+    fputs("    switch (field) {\n", out);
+    for (uint32_t field = 0; field < 81u; ++field) {
+        fprintf(out, "    case %u:\n", field);
+        for (uint32_t p = 0; p < PEER_COUNT; ++p) {
+            fprintf(out, "        data[%u] &= mask;\n", FIELD_PEERS[field][p]);
+        }
+        fputs("        break;\n", out);
+    }
+    fputs("    }\n}\n\n\n", out);
+}
+
+
+// recompute_adjacent: the candidates of the field and its empty peers are whatever their three units do not hold yet
+void write_recompute_candidates(FILE* out) {
+    fputs("static inline void kernel_recompute_candidates(uint32_t* data, uint32_t field) {\n", out);
+    fputs("    uint32_t placed[27];\n", out);
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        fprintf(out, "    placed[%u] = ", unit);
+        for (uint32_t k = 0; k < 9; ++k) {
+            fprintf(out, k ? " | data[%u]" : "data[%u]", UNIT_FIELDS[unit][k]);
+        }
+        fputs(";\n", out);
+    }
+    fputs("    switch (field) {\n", out);
+    for (uint32_t field = 0; field < 81u; ++field) {
+        fprintf(out, "    case %u:\n", field);
+        for (uint32_t p = 0; p <= PEER_COUNT; ++p) {
+            uint32_t peer = p < PEER_COUNT ? FIELD_PEERS[field][p] : field;
+            const uint8_t* units = FIELD_UNITS[peer];
+            fprintf(out, "        if (!(data[%u] & 0xffffu)) data[%u] = (~(placed[%u] | placed[%u] | placed[%u]) & 0x1ffu) << 16;\n",
+                    peer, peer, units[0], units[1], units[2]);
+        }
+        fputs("        break;\n", out);
+    }
+    fputs("    }\n}\n\n\n", out);
+}
+
+
+// count_neighbors: filled fields in the row, column and square of the field, counted once per unit they share with it
+void write_count_neighbors(FILE* out) {
+    fputs("static inline uint32_t kernel_count_neighbors(const uint32_t* data, uint32_t field) {\n", out);
+    fputs("    switch (field) {\n", out);
+    for (uint32_t field = 0; field < 81u; ++field) {
+        fprintf(out, "    case %u:\n        return 3u * (0 != (data[%u] & 0xffffu))", field, field);
+        for (uint32_t p = 0; p < PEER_COUNT; ++p) {
+            uint32_t peer = FIELD_PEERS[field][p];
+            uint32_t shared = shares_unit(field, peer);
+            if (shared > 1) {
+                fprintf(out, "\n            + %uu * (0 != (data[%u] & 0xffffu))", shared, peer);
+            } else {
+                fprintf(out, "\n            + (0 != (data[%u] & 0xffffu))", peer);
+            }
+        }
+        fputs(";\n", out);
+    }
+    fputs("    }\n    return 0;\n}\n\n\n", out);
+}
+
+
+// hidden_singles: every unit in turn, a candidate left in a single field of the unit is placed there
+// fields are read again after each put, which may have cleared the candidates of later fields
+void write_hidden_singles(FILE* out) {
+    fputs("static inline bool kernel_hidden_singles(Sudoku* sudoku) {\n", out);
+    fputs("    uint32_t* data = sudoku->data;\n", out);
+    fputs("    uint32_t once_or_more, twice_or_more, once, intersect;\n", out);
+    fputs("    bool found = false;\n", out);
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        fprintf(out, "\n    // unit %u\n", unit);
+        fputs("    once_or_more = 0;\n    twice_or_more = 0;\n", out);
+        for (uint32_t k = 0; k < 9; ++k) {
+            uint32_t field = UNIT_FIELDS[unit][k];
+            fprintf(out, "    twice_or_more |= once_or_more & data[%u];\n    once_or_more |= data[%u];\n", field, field);
+        }
+        fputs("    once = once_or_more & ~twice_or_more & 0xffff0000u;\n", out);
+        fputs("    if (once) {\n        found = true;\n", out);
+        for (uint32_t k = 0; k < 9; ++k) {
+            uint32_t field = UNIT_FIELDS[unit][k];
+            fprintf(out, "        intersect = data[%u] & once;\n", field);
+            fprintf(out, "        if (intersect) put(sudoku, %u, intersect >> 16);\n", field);
+        }
+        fputs("    }\n", out);
+    }
+    fputs("    return found;\n}\n", out);
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <output path>\n", argv[0]);
+        return 1;
+    }
+    FILE* out = fopen(argv[1], "w");
+    if (!out) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fputs("// generated by kernel_generator.c, do not edit\n", out);
+    fputs("// included by sudoku.c after put and by heuristics.c\n\n", out);
+    fputs("#ifndef SUDOKU_KERNELS_H\n#define SUDOKU_KERNELS_H\n\n", out);
+    fputs("#include \"sudoku.h\"\n\n#include <stdbool.h>\n#include <stdint.h>\n\n\n", out);
+    write_remove_peer_candidates(out);
+    write_recompute_candidates(out);
+    write_count_neighbors(out);
+    // the hidden singles kernel places values, which only sudoku.c can do
+    fputs("#ifdef SUDOKU_KERNELS_PUT\n\n", out);
+    write_hidden_singles(out);
+    fputs("\n#endif\n\n#endif\n", out);
+    return fclose(out) == 0 ? 0 : 1;
+}
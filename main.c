@@ -1,13 +1,537 @@
 #include "utils.h"
-#include "sudoku.h"
-#include "generator.h"
+#include "sudokugen.h"
+#include "store.h"
+#include "removal_search.h"
+#include "solution_count.h"
+#include "bandit.h"
+#include "rater.h"
+#include "pattern.h"
+#include "monotonic.h"
+#include "trace.h"
+#include "shard.h"
 #include "tests.h"
 #include "errno.h"
 
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
 #include <time.h>
 
+#ifdef SUDOKUGEN_DAEMON
+#include "daemon.h"
+#endif
+#ifdef SUDOKUGEN_PIPELINE
+#include "pipeline.h"
+#endif
+
+#define BATCH_SIZE 16u
+
+
+void write_instances(const char* instances, uint32_t count) {
+    TRACE_BEGIN(span);
+    for (uint32_t k = 0; k < count; ++k) {
+        fwrite(instances + k * SUDOKUGEN_CHARS_PER_INSTANCE, 1, SUDOKUGEN_CHARS_PER_INSTANCE, stdout);
+        fputc('\n', stdout);
+    }
+    TRACE_END(span, "write");
+}
+
+
+void finish_trace() {
+    if (!trace_finish())
+        fprintf(stderr, "could not write the trace\n");
+}
+
+
+// gensudoku --store <path> [instances] [seconds per instance]
+// generates and rates instances, appends them to the store in bulk and rebuilds the index
+int store_generated(int argc, char** argv) {
+    uint32_t num_instances_to_generate = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+    SudokuGenConfig config = sudokugen_default_config();
+    if (argc > 4) config.max_seconds = strtof(argv[4], NULL);
+    if (errno == ERANGE) return 1;
+
+    SudokuGenContext* context = sudokugen_create(&config, time(NULL));
+    StoreWriter* writer = store_open_writer(argv[2]);
+    if (!context || !writer) return 1;
+
+    char instances[BATCH_SIZE * SUDOKUGEN_CHARS_PER_INSTANCE];
+    uint8_t ratings[BATCH_SIZE];
+    bool success = true;
+    for (uint32_t i = 0; i < num_instances_to_generate && success; i += BATCH_SIZE) {
+        uint32_t batch_size = min(BATCH_SIZE, num_instances_to_generate - i);
+        sudokugen_generate(context, instances, batch_size);
+        rate_instances(instances, ratings, batch_size);
+        success = store_append(writer, instances, ratings, batch_size);
+    }
+
+    success &= store_close_writer(writer);
+    sudokugen_destroy(context);
+    return success && store_build_index(argv[2]) ? 0 : 1;
+}
+
+
+// gensudoku --store-fetch <path> <hints> [instances] [difficulty]
+// prints random instances from one bucket of the store
+int store_fetch(int argc, char** argv) {
+    if (argc < 4) return 1;
+    uint32_t hints = strtoul(argv[3], NULL, 10);
+    uint32_t count = argc > 4 ? strtoul(argv[4], NULL, 10) : 1;
+    uint32_t difficulty = argc > 5 ? strtoul(argv[5], NULL, 10) : 0;
+    if (errno == ERANGE) return 1;
+
+    StoreReader* reader = store_open_reader(argv[2]);
+    if (!reader) return 1;
+    Rng rng;
+    rng_seed(&rng, time(NULL));
+    for (uint32_t i = 0; i < count; ++i) {
+        const StoreRecord* record = store_random_record(reader, hints, difficulty, &rng);
+        if (!record) break;
+        fwrite(record->instance, 1, sizeof(record->instance), stdout);
+        fputc('\n', stdout);
+    }
+    store_close_reader(reader);
+    return 0;
+}
+
+
+// gensudoku --resumable <max hints> <checkpoint path> [seconds between checkpoints]
+// exhaustive search for a single instance, which may take hours for low hint counts
+// continues from the checkpoint if it exists, in which case max hints is taken from the checkpoint
+int resumable_exhaustive(int argc, char** argv) {
+    if (argc < 4) return 1;
+    uint32_t max_hints = strtoul(argv[2], NULL, 10);
+    double interval = argc > 4 ? strtod(argv[4], NULL) : 60.0;
+    if (errno == ERANGE) return 1;
+
+    RemovalSearch search;
+    if (!removal_search_load(&search, argv[3])) {
+        Rng rng;
+        rng_seed(&rng, time(NULL));
+        Sudoku solution = sudoku_new_empty();
+        sudoku_solve_random(&solution, &rng);
+        removal_search_init_exhaustive(&search, &solution, SYMMETRY_NONE, max_hints, &rng);
+    }
+
+    // one slice per checkpoint
+    RemovalStatus status;
+    SearchBudget slice;
+    do {
+        budget_init(&slice);
+        budget_set_seconds(&slice, interval);
+        status = removal_search_run(&search, &slice, max_neighbors_heuristic, NULL, NULL);
+    } while (status == REMOVAL_SUSPENDED && removal_search_save(&search, argv[3]));
+    if (status == REMOVAL_SUSPENDED) return 1;
+    remove(argv[3]);
+
+    if (status != REMOVAL_FOUND) {
+        fprintf(stderr, "no instance with at most %u hints for this solution\n", search.target_hints);
+        return 1;
+    }
+    Sudoku result = removal_search_result(&search);
+    sudoku_print(&result);
+    return 0;
+}
+
+
+void print_instance(const Sudoku* instance, void* state) {
+    sudoku_print(instance);
+    fflush(stdout);
+}
+
+
+// gensudoku --stream <max hints> [seconds] [diverge levels]
+// runs a single time-bounded search and prints every distinct instance with at most max hints hints as soon as it is found
+int stream_instances(int argc, char** argv) {
+    uint32_t max_hints = strtoul(argv[2], NULL, 10);
+    float seconds = argc > 3 ? strtof(argv[3], NULL) : 1.0f;
+    uint32_t diverge_levels = argc > 4 ? strtoul(argv[4], NULL, 10) : 2;
+    if (errno == ERANGE) return 1;
+
+    RemovalSink sink;
+    if (!removal_sink_init(&sink, max_hints, diverge_levels, print_instance, NULL)) return 1;
+    Rng rng;
+    rng_seed(&rng, time(NULL));
+    Sudoku solution = sudoku_new_empty();
+    sudoku_solve_random(&solution, &rng);
+    RemovalSearch search;
+    removal_search_init_time_bounded(&search, &solution, SYMMETRY_NONE, &rng);
+    SearchBudget budget;
+    budget_init(&budget);
+    budget_set_seconds(&budget, seconds);
+    removal_search_run(&search, &budget, max_neighbors_heuristic, NULL, &sink);
+    removal_sink_destroy(&sink);
+    return 0;
+}
+
+
+bool parse_symmetry(const char* name, Symmetry* symmetry) {
+    static const char* names[] = {"none", "180", "90", "vertical", "horizontal", "diagonal"};
+    for (uint32_t s = 0; s <= SYMMETRY_MIRROR_DIAGONAL; ++s) {
+        if (strcmp(name, names[s]) == 0) {
+            *symmetry = (Symmetry) s;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// gensudoku --symmetric <180|90|vertical|horizontal|diagonal> [instances] [seconds per instance]
+// generates instances whose hints have the given rotational or mirror symmetry
+int symmetric_generated(int argc, char** argv) {
+    SudokuGenConfig config = sudokugen_default_config();
+    if (!parse_symmetry(argv[2], &config.symmetry)) return 1;
+    uint32_t num_instances_to_generate = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+    if (argc > 4) config.max_seconds = strtof(argv[4], NULL);
+    if (errno == ERANGE) return 1;
+
+    SudokuGenContext* context = sudokugen_create(&config, time(NULL));
+    if (!context) return 1;
+
+    char instances[BATCH_SIZE * SUDOKUGEN_CHARS_PER_INSTANCE];
+    for (uint32_t i = 0; i < num_instances_to_generate; i += BATCH_SIZE) {
+        uint32_t batch_size = min(BATCH_SIZE, num_instances_to_generate - i);
+        sudokugen_generate(context, instances, batch_size);
+        write_instances(instances, batch_size);
+    }
+    sudokugen_destroy(context);
+    return 0;
+}
+
+
+// gensudoku --exact <hints> [instances] [seconds per search] [none|180|90|vertical|horizontal|diagonal] [searches per instance]
+// generates instances with exactly the given number of hints, prints the yield and cost per instance to stderr
+// gives up on an instance after the given number of searches (1000 by default), which bounds the total time
+int exact_generated(int argc, char** argv) {
+    SudokuGenConfig config = sudokugen_default_config();
+    config.exact_hints = strtoul(argv[2], NULL, 10);
+    uint32_t num_instances_to_generate = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+    if (argc > 4) config.max_seconds = strtof(argv[4], NULL);
+    if (errno == ERANGE || config.exact_hints < MIN_UNIQUE_HINTS || config.exact_hints > 81) return 1;
+    if (argc > 5 && !parse_symmetry(argv[5], &config.symmetry)) return 1;
+    config.exact_max_searches = argc > 6 ? strtoul(argv[6], NULL, 10) : 1000;
+    if (errno == ERANGE || config.exact_max_searches == 0) return 1;
+
+    SudokuGenContext* context = sudokugen_create(&config, time(NULL));
+    if (!context) return 1;
+
+    clock_t start = clock();
+    char instances[BATCH_SIZE * SUDOKUGEN_CHARS_PER_INSTANCE];
+    bool complete = true;
+    for (uint32_t i = 0; i < num_instances_to_generate && complete; i += BATCH_SIZE) {
+        uint32_t batch_size = min(BATCH_SIZE, num_instances_to_generate - i);
+        uint32_t generated = sudokugen_generate(context, instances, batch_size);
+        write_instances(instances, generated);
+        complete = generated == batch_size;
+    }
+    double cpu_seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    SudokuGenStats stats = sudokugen_stats(context);
+    double accepted = (double) stats.instances_generated;
+    fprintf(stderr, "%llu instances from %llu searches, %.1f %% yield, %.2f hints added and %.4f cpu seconds per instance\n",
+            (unsigned long long) stats.instances_generated, (unsigned long long) stats.searches,
+            stats.searches ? 100.0 * accepted / stats.searches : 0.0,
+            accepted > 0.0 ? stats.hints_added / accepted : 0.0, accepted > 0.0 ? cpu_seconds / accepted : 0.0);
+    if (!complete)
+        fprintf(stderr, "gave up after %u searches without an instance of %u hints\n", config.exact_max_searches, config.exact_hints);
+    sudokugen_destroy(context);
+    return complete ? 0 : 1;
+}
+
+
+// gensudoku --shard <i/n> <seed> <instances> [checks per instance]
+// generates shard i of n of a job of the given number of instances, numbered by the job so that shards are disjoint
+// budgets are in removability checks instead of seconds, so every instance can be reproduced from the seed
+int shard_generated(int argc, char** argv) {
+    ShardSpec shard;
+    if (argc < 5 || !shard_parse(argv[2], &shard)) return 1;
+    uint64_t seed = strtoull(argv[3], NULL, 10);
+    uint64_t total = strtoull(argv[4], NULL, 10);
+    SudokuGenConfig config = sudokugen_default_config();
+    config.max_seconds = INFINITY;
+    config.max_checks = argc > 5 ? strtoull(argv[5], NULL, 10) : 50000;
+    if (errno == ERANGE || config.max_checks == 0) return 1;
+
+    SudokuGenContext* context = sudokugen_create(&config, seed);
+    if (!context) return 1;
+
+    uint64_t begin, end;
+    shard_range(&shard, total, &begin, &end);
+    char instances[BATCH_SIZE * SUDOKUGEN_CHARS_PER_INSTANCE];
+    uint32_t batch_size = 0;
+    for (uint64_t instance = begin; instance < end; ++instance) {
+        sudokugen_reseed(context, shard_instance_seed(seed, instance));
+        sudokugen_generate(context, instances + batch_size * SUDOKUGEN_CHARS_PER_INSTANCE, 1);
+        if (++batch_size == BATCH_SIZE || instance + 1 == end) {
+            write_instances(instances, batch_size);
+            batch_size = 0;
+        }
+    }
+    sudokugen_destroy(context);
+    return 0;
+}
+
+
+// gensudoku --merge <paths...>
+// prints the distinct instances of all files in lexicographic order, e.g. to combine the outputs of --shard
+int merge_shards(int argc, char** argv) {
+    uint32_t count = (uint32_t) argc - 2;
+    FILE** inputs = calloc(count, sizeof(FILE*));
+    if (!inputs) return 1;
+    bool success = true;
+    for (uint32_t i = 0; i < count && success; ++i) {
+        inputs[i] = fopen(argv[i + 2], "r");
+        if (!inputs[i]) {
+            perror(argv[i + 2]);
+            success = false;
+        }
+    }
+
+    ShardMergeStats stats = {0, 0, 0};
+    success = success && shard_merge(inputs, count, stdout, &stats);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (inputs[i])
+            fclose(inputs[i]);
+    }
+    free(inputs);
+    fprintf(stderr, "%llu instances read, %llu distinct written, %u sorted runs spilled\n",
+            (unsigned long long) stats.read, (unsigned long long) stats.written, stats.runs);
+    return success ? 0 : 1;
+}
+
+
+// gensudoku --pattern <pattern> [seconds] [threads]
+// finds an instance whose hints lie exactly on the pattern, 81 characters where '0' and '.' are blank and all others hints
+// searches in parallel on all cores by default, stops after 60 seconds by default and fails if nothing was found by then
+int pattern_generated(int argc, char** argv) {
+    if (strlen(argv[2]) < 81) return 1;
+    FieldSubset pattern;
+    fs_exclude_all_fields(&pattern);
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (argv[2][i] != '0' && argv[2][i] != '.')
+            fs_set_field(&pattern, i);
+    }
+    double seconds = argc > 3 ? strtod(argv[3], NULL) : 60.0;
+    uint32_t threads = argc > 4 ? strtoul(argv[4], NULL, 10) : 0;
+    if (errno == ERANGE) return 1;
+
+    Sudoku instance;
+    PatternStats stats = {0, 0, 0};
+    double start = monotonic_seconds();
+    bool found = generate_sudoku_with_pattern_parallel(&pattern, threads, seconds, time(NULL), &instance, &stats);
+    fprintf(stderr, "%llu grids checked, %llu partial grids pruned, %llu restarts in %.3f s\n", (unsigned long long) stats.grids,
+            (unsigned long long) stats.pruned, (unsigned long long) stats.restarts, monotonic_seconds() - start);
+    if (!found) return 1;
+
+    char out[SUDOKUGEN_CHARS_PER_INSTANCE];
+    sudoku_to_string(&instance, out);
+    fwrite(out, 1, SUDOKUGEN_CHARS_PER_INSTANCE, stdout);
+    fputc('\n', stdout);
+    return 0;
+}
+
+
+// reports at most once per second
+void print_count_progress(uint64_t solutions, uint32_t tasks_done, uint32_t tasks_total, void* state) {
+    time_t* last_report = state;
+    if (difftime(time(NULL), *last_report) < 1.0 && tasks_done < tasks_total)
+        return;
+    *last_report = time(NULL);
+    fprintf(stderr, "%llu solutions, %u of %u subtrees\n", (unsigned long long) solutions, tasks_done, tasks_total);
+}
+
+
+// gensudoku --count [cap] [threads] [seconds per instance]
+// reads instances from stdin, one per line, and prints their number of solutions
+// prefixed with >= if the cap was hit or time ran out, lines with characters other than 0-9 and . are skipped
+int count_solutions(int argc, char** argv) {
+    CountConfig config = count_default_config();
+    if (argc > 2) config.cap = strtoull(argv[2], NULL, 10);
+    if (argc > 3) config.threads = strtoul(argv[3], NULL, 10);
+    if (argc > 4) config.max_seconds = strtod(argv[4], NULL);
+    if (errno == ERANGE) return 1;
+    time_t last_report = time(NULL);
+    config.progress = print_count_progress;
+    config.progress_state = &last_report;
+
+    char line[256];
+    while (fgets(line, sizeof(line), stdin)) {
+        if (strlen(line) < SUDOKUGEN_CHARS_PER_INSTANCE)
+            continue;
+        Sudoku sudoku;
+        if (!sudoku_from_string(&sudoku, line)) {
+            fprintf(stderr, "skipped invalid instance %.81s\n", line);
+            continue;
+        }
+        CountResult result = sudoku_count_solutions(&sudoku, &config);
+        if (result.tasks == UINT32_MAX) return 1;
+        printf("%s%llu\n", result.capped || result.interrupted ? ">=" : "", (unsigned long long) result.solutions);
+        fflush(stdout);
+    }
+    return 0;
+}
+
+
+// gensudoku --rate
+// reads instances from stdin, one per line, and prints each one with its rating
+// the number of instances per rating and the throughput are printed to stderr
+int rate_input() {
+    enum { CHUNK = 4096 };
+    static char instances[CHUNK * SUDOKUGEN_CHARS_PER_INSTANCE];
+    static uint8_t ratings[CHUNK];
+    uint64_t histogram[RATING_LEVELS] = {0};
+    uint64_t total = 0;
+    double seconds = 0.0;
+
+    char line[256];
+    bool more = true;
+    while (more) {
+        uint32_t count = 0;
+        while (count < CHUNK && (more = fgets(line, sizeof(line), stdin) != NULL)) {
+            if (strlen(line) < SUDOKUGEN_CHARS_PER_INSTANCE)
+                continue;
+            memcpy(instances + count * SUDOKUGEN_CHARS_PER_INSTANCE, line, SUDOKUGEN_CHARS_PER_INSTANCE);
+            ++count;
+        }
+        double start = monotonic_seconds();
+        rate_instances(instances, ratings, count);
+        seconds += monotonic_seconds() - start;
+        for (uint32_t i = 0; i < count; ++i) {
+            fwrite(instances + i * SUDOKUGEN_CHARS_PER_INSTANCE, 1, SUDOKUGEN_CHARS_PER_INSTANCE, stdout);
+            printf(" %u\n", ratings[i]);
+            ++histogram[ratings[i]];
+        }
+        total += count;
+    }
+
+    for (uint32_t rating = 0; rating < RATING_LEVELS; ++rating) {
+        fprintf(stderr, "%u %-17s %llu\n", rating, rating_name((Rating) rating), (unsigned long long) histogram[rating]);
+    }
+    fprintf(stderr, "%llu instances rated in %.3f s, %.0f per second\n", (unsigned long long) total, seconds,
+            seconds > 0.0 ? total / seconds : 0.0);
+    return 0;
+}
+
+
+// gensudoku --adaptive [instances] [seconds per instance] [ucb|thompson]
+// like the default mode, but a bandit chooses among all heuristics per instance, its statistics are printed to stderr
+int adaptive_generated(int argc, char** argv) {
+    uint32_t num_instances_to_generate = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+    SudokuGenConfig config = sudokugen_default_config();
+    if (argc > 3) config.max_seconds = strtof(argv[3], NULL);
+    if (errno == ERANGE) return 1;
+    BanditPolicy policy = argc > 4 && strcmp(argv[4], "thompson") == 0 ? BANDIT_THOMPSON : BANDIT_UCB;
+
+    uint64_t seed = time(NULL);
+    BanditHeuristic bandit;
+    bandit_init(&bandit, policy, seed);
+    bandit_add_default_arms(&bandit);
+    config.heuristic = bandit_heuristic;
+    config.heuristic_state = &bandit;
+
+    SudokuGenContext* context = sudokugen_create(&config, seed);
+    if (!context) return 1;
+
+    char instances[BATCH_SIZE * SUDOKUGEN_CHARS_PER_INSTANCE];
+    for (uint32_t i = 0; i < num_instances_to_generate; i += BATCH_SIZE) {
+        uint32_t batch_size = min(BATCH_SIZE, num_instances_to_generate - i);
+        sudokugen_generate(context, instances, batch_size);
+        write_instances(instances, batch_size);
+    }
+    sudokugen_destroy(context);
+    bandit_print_stats(&bandit, stderr);
+    return 0;
+}
+
+
+#ifdef SUDOKUGEN_PIPELINE
+// gensudoku --pipeline [instances] [seconds per instance] [fill threads] [dig threads] [dedup 0|1]
+// prints the instances to stdout and the per-stage utilization to stderr
+int run_pipeline(int argc, char** argv) {
+    PipelineConfig config = pipeline_default_config();
+    config.generation.heuristic = max_neighbors_heuristic;
+    if (argc > 2) config.num_instances = strtoull(argv[2], NULL, 10);
+    if (argc > 3) config.generation.max_seconds = strtof(argv[3], NULL);
+    if (argc > 4) config.fill_threads = strtoul(argv[4], NULL, 10);
+    if (argc > 5) config.dig_threads = strtoul(argv[5], NULL, 10);
+    if (argc > 6) config.dedup = strtoul(argv[6], NULL, 10) != 0;
+    if (errno == ERANGE) return 1;
+
+    PipelineStats stats;
+    bool success = pipeline_run(&config, &stats);
+    pipeline_print_stats(&stats, stderr);
+    return success ? 0 : 1;
+}
+#endif
+
+
 int main(int argc, char** argv) {
-    srand(time(NULL));
+    // GENSUDOKU_TRACE=<path> records a timeline of all modes, GENSUDOKU_TRACE_SLOW_US=<microseconds> drops shorter checks
+    const char* trace_path = getenv("GENSUDOKU_TRACE");
+    if (trace_path && *trace_path) {
+        const char* slow = getenv("GENSUDOKU_TRACE_SLOW_US");
+        if (trace_start(trace_path, slow ? strtod(slow, NULL) * 1e-6 : 0.0)) {
+            atexit(finish_trace);
+        } else {
+            fprintf(stderr, "tracing is not compiled in\n");
+        }
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--store") == 0)
+        return store_generated(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--store-fetch") == 0)
+        return store_fetch(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--count") == 0)
+        return count_solutions(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--rate") == 0)
+        return rate_input();
+    // gensudoku --measure-restarts [instances] [checks per instance]
+    if (argc > 1 && strcmp(argv[1], "--measure-restarts") == 0) {
+        measure_restarts(argc > 2 ? strtoul(argv[2], NULL, 10) : 100, argc > 3 ? strtoull(argv[3], NULL, 10) : 50000);
+        return 0;
+    }
+    // gensudoku --measure-checks [instances] [checks per instance]
+    if (argc > 1 && strcmp(argv[1], "--measure-checks") == 0) {
+        measure_check_tiers(argc > 2 ? strtoul(argv[2], NULL, 10) : 100, argc > 3 ? strtoull(argv[3], NULL, 10) : 20000);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--adaptive") == 0)
+        return adaptive_generated(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--symmetric") == 0)
+        return symmetric_generated(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--pattern") == 0)
+        return pattern_generated(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--exact") == 0)
+        return exact_generated(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--shard") == 0)
+        return shard_generated(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--merge") == 0)
+        return merge_shards(argc, argv);
+    if (argc > 2 && strcmp(argv[1], "--stream") == 0)
+        return stream_instances(argc, argv);
+    if (argc > 3 && strcmp(argv[1], "--resumable") == 0)
+        return resumable_exhaustive(argc, argv);
+    // gensudoku --store-merge <target path> <source paths...>
+    if (argc > 2 && strcmp(argv[1], "--store-merge") == 0)
+        return store_merge(argv[2], (const char**) argv + 3, argc - 3) ? 0 : 1;
+
+#ifdef SUDOKUGEN_DAEMON
+    // gensudoku --daemon [socket path] [threads]
+    if (argc > 1 && strcmp(argv[1], "--daemon") == 0) {
+        DaemonConfig daemon_config = daemon_default_config();
+        if (argc > 2) daemon_config.socket_path = argv[2];
+        if (argc > 3) {
+            daemon_config.num_threads = strtoul(argv[3], NULL, 10);
+            if (errno == ERANGE) exit(1);
+        }
+        return daemon_run(&daemon_config);
+    }
+#endif
+#ifdef SUDOKUGEN_PIPELINE
+    if (argc > 1 && strcmp(argv[1], "--pipeline") == 0)
+        return run_pipeline(argc, argv);
+#endif
 
     uint32_t num_instances_to_generate = 1;
     if (argc > 1) {
@@ -15,14 +539,23 @@ int main(int argc, char** argv) {
         if (errno == ERANGE) exit(1);
     }
 
-    float max_seconds_per_instance = 0.1f;
+    SudokuGenConfig config = sudokugen_default_config();
+    config.strategy = SUDOKUGEN_TIME_BOUNDED;
+    config.heuristic = max_neighbors_heuristic;
     if (argc > 2) {
-        max_seconds_per_instance = strtof(argv[2], NULL);
+        config.max_seconds = strtof(argv[2], NULL);
         if (errno == ERANGE) exit(1);
     }
 
-    for (uint32_t i = 0; i < num_instances_to_generate; ++i) {
-        Sudoku s = generate_sudoku_with_min_hints_time_bounded(max_seconds_per_instance, min_neighbors_heuristic, NULL);
-        sudoku_print(&s);
+    SudokuGenContext* context = sudokugen_create(&config, time(NULL));
+    if (!context) exit(1);
+
+    char instances[BATCH_SIZE * SUDOKUGEN_CHARS_PER_INSTANCE];
+    for (uint32_t i = 0; i < num_instances_to_generate; i += BATCH_SIZE) {
+        uint32_t batch_size = min(BATCH_SIZE, num_instances_to_generate - i);
+        sudokugen_generate(context, instances, batch_size);
+        write_instances(instances, batch_size);
     }
+
+    sudokugen_destroy(context);
 }
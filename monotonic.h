@@ -0,0 +1,43 @@
+#ifndef MONOTONIC_H
+#define MONOTONIC_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// wall-clock seconds since an arbitrary starting point, unaffected by system clock adjustments
+// unlike clock(), this does not add up the cpu time of all threads
+static inline double monotonic_seconds() {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (double) now.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+#endif
+}
+
+// cpu seconds spent by the calling thread, unaffected by other threads and by time spent waiting
+static inline double thread_cpu_seconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    uint64_t total = ((uint64_t) kernel.dwHighDateTime << 32u | kernel.dwLowDateTime)
+            + ((uint64_t) user.dwHighDateTime << 32u | user.dwLowDateTime);
+    // 100 ns ticks
+    return (double) total * 1e-7;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+#endif
+}
+
+#endif
@@ -0,0 +1,291 @@
+#include "pattern.h"
+#include "generator.h"
+#include "units.h"
+#include "utils.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// complete grids checked in the shortest run between two restarts
+#define PATTERN_RESTART_GRIDS 32u
+
+typedef struct {
+    bool in_pattern[81];
+    // digits 1-9, 0 for fields not filled yet
+    uint8_t values[81];
+    // digits not tried yet in each field up to the current one
+    uint16_t untried[81];
+    // 9 bit masks of the digits in each unit
+    uint16_t used[UNIT_COUNT];
+    // digit_fields[u][d]: field of digit d + 1 in unit u, only valid if the digit is used in the unit
+    uint8_t digit_fields[UNIT_COUNT][9];
+} PatternSearch;
+
+typedef enum {
+    PATTERN_FOUND,
+    // the run reached its grid limit or the budget is exhausted
+    PATTERN_RUN_OVER,
+    // no grid yields a unique instance on the pattern
+    PATTERN_EXHAUSTED
+} PatternRunStatus;
+
+
+void pattern_place(PatternSearch* search, uint32_t field, uint32_t digit) {
+    search->values[field] = (uint8_t) digit;
+    for (uint32_t t = 0; t < 3; ++t) {
+        uint32_t unit = FIELD_UNITS[field][t];
+        search->used[unit] |= 1u << (digit - 1);
+        search->digit_fields[unit][digit - 1] = (uint8_t) field;
+    }
+}
+
+
+void pattern_clear(PatternSearch* search, uint32_t field) {
+    for (uint32_t t = 0; t < 3; ++t) {
+        search->used[FIELD_UNITS[field][t]] &= ~(1u << (search->values[field] - 1));
+    }
+    search->values[field] = 0;
+}
+
+
+uint16_t allowed_digits(const PatternSearch* search, uint32_t field) {
+    const uint8_t* units = FIELD_UNITS[field];
+    return (uint16_t) (ALL_CANDIDATES & ~(search->used[units[0]] | search->used[units[1]] | search->used[units[2]]));
+}
+
+
+uint32_t pick_digit(uint16_t digits, Rng* rng) {
+    uint32_t skip = rng_range(rng, 0, population_count(digits));
+    while (skip--) {
+        digits &= digits - 1;
+    }
+    return lowest_set_bit_index(digits) + 1;
+}
+
+
+// whether the field, just filled, completes a rectangle x y / y x outside of the pattern, which swaps into y x / x y
+// fields are filled in row-major order, so the field is the bottom right corner
+// the two rows must share a band or the two columns a stack, but not both
+bool completes_rectangle(const PatternSearch* search, uint32_t field) {
+    if (search->in_pattern[field])
+        return false;
+    uint32_t row = field / 9, column = field % 9;
+    for (uint32_t left = 0; left < column; ++left) {
+        uint32_t bottom_left = row * 9 + left;
+        uint32_t y = search->values[bottom_left];
+        if (search->in_pattern[bottom_left] || !(search->used[9 + column] & (1u << (y - 1))))
+            continue;
+        uint32_t top_right = search->digit_fields[9 + column][y - 1];
+        uint32_t top_left = top_right - column + left;
+        if (search->values[top_left] != search->values[field] || search->in_pattern[top_left] || search->in_pattern[top_right])
+            continue;
+        if ((top_right / 27 == row / 3) != (left / 3 == column / 3))
+            return true;
+    }
+    return false;
+}
+
+
+// the fields of two digits a and b, linked whenever an a and a b share a unit, fall into components
+// a and b can be swapped within any component, so each one is an unavoidable set
+// a component is complete once every unit it touches holds both its a and its b, which happens in its last row at the latest
+// checks the components through the just completed row, which are the only ones that can have become complete,
+// and sets last to the last field of one without any field in the pattern
+bool completes_digit_pair_set(const PatternSearch* search, uint32_t row, uint32_t* last) {
+    for (uint32_t a = 0; a < 8; ++a) {
+        for (uint32_t b = a + 1; b < 9; ++b) {
+            uint8_t component[18];
+            uint32_t size = 1;
+            component[0] = search->digit_fields[row][a];
+            bool complete = true, hinted = false;
+            for (uint32_t n = 0; n < size && complete && !hinted; ++n) {
+                uint32_t field = component[n];
+                uint32_t other = search->values[field] - 1u == a ? b : a;
+                hinted = search->in_pattern[field];
+                for (uint32_t t = 0; t < 3 && complete; ++t) {
+                    uint32_t unit = FIELD_UNITS[field][t];
+                    if (!(search->used[unit] & (1u << other))) {
+                        complete = false;
+                        break;
+                    }
+                    uint32_t partner = search->digit_fields[unit][other];
+                    uint32_t k = 0;
+                    while (k < size && component[k] != partner) {
+                        ++k;
+                    }
+                    if (k == size)
+                        component[size++] = (uint8_t) partner;
+                }
+            }
+            if (!complete || hinted)
+                continue;
+            *last = 0;
+            for (uint32_t n = 0; n < size; ++n) {
+                *last = component[n] > *last ? component[n] : *last;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// returns true if the grid restricted to the pattern is unique
+// otherwise sets last to the last field where a second solution differs, these fields form an unavoidable set
+bool check_pattern_instance(const PatternSearch* search, Sudoku* instance, uint32_t* last) {
+    sudoku_init(instance);
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (search->in_pattern[i])
+            sudoku_put_value(instance, i, search->values[i]);
+    }
+
+    for (uint32_t direction = 0; direction < 2; ++direction) {
+        Sudoku solution = *instance;
+        if (direction == 0) {
+            sudoku_solve(&solution);
+        } else {
+            sudoku_solve_reverse(&solution);
+        }
+        bool differs = false;
+        for (uint32_t i = 0; i < 81u; ++i) {
+            if (sudoku_read_value(&solution, i) != search->values[i]) {
+                differs = true;
+                *last = i;
+            }
+        }
+        if (differs)
+            return false;
+    }
+    return true;
+}
+
+
+// one run of the depth-first search from an empty grid, checking at most max_grids complete grids
+// after an unavoidable set outside of the pattern, the search backjumps to its last field
+// since whatever follows, the set stays unavoidable
+PatternRunStatus run_pattern_search(PatternSearch* search, uint64_t max_grids, SearchBudget* budget, Rng* rng, Sudoku* out, PatternStats* stats) {
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        search->used[unit] = 0;
+    }
+
+    uint64_t grids = 0;
+    uint32_t position = 0;
+    uint32_t last;
+    search->untried[0] = ALL_CANDIDATES;
+    while (true) {
+        if (position == 81) {
+            if (grids++ == max_grids)
+                return PATTERN_RUN_OVER;
+            budget_spend_checks(budget, 1);
+            ++stats->grids;
+            if (check_pattern_instance(search, out, &last))
+                return PATTERN_FOUND;
+            while (position > last) {
+                pattern_clear(search, --position);
+            }
+            continue;
+        }
+        if (!search->untried[position]) {
+            if (position == 0)
+                return PATTERN_EXHAUSTED;
+            pattern_clear(search, --position);
+            continue;
+        }
+        if (!budget_spend_node(budget))
+            return PATTERN_RUN_OVER;
+
+        uint32_t digit = pick_digit(search->untried[position], rng);
+        search->untried[position] &= ~(1u << (digit - 1));
+        pattern_place(search, position, digit);
+        if (completes_rectangle(search, position)) {
+            ++stats->pruned;
+            pattern_clear(search, position);
+            continue;
+        }
+        if (position % 9 == 8 && completes_digit_pair_set(search, position / 9, &last)) {
+            ++stats->pruned;
+            ++position;
+            while (position > last) {
+                pattern_clear(search, --position);
+            }
+            continue;
+        }
+        if (++position < 81)
+            search->untried[position] = allowed_digits(search, position);
+    }
+}
+
+
+bool generate_sudoku_with_pattern(const FieldSubset* pattern, SearchBudget* budget, Rng* rng, Sudoku* out, PatternStats* stats) {
+    PatternSearch search;
+    FieldSubset fields = *pattern;
+    uint32_t hints = 0;
+    for (uint32_t i = 0; i < 81u; ++i) {
+        search.in_pattern[i] = fs_get_field(&fields, i);
+        hints += search.in_pattern[i];
+    }
+    if (hints < MIN_UNIQUE_HINTS)
+        return false;
+
+    PatternStats local = {0, 0, 0};
+    RestartSchedule schedule = {RESTART_LUBY, PATTERN_RESTART_GRIDS, 0.0};
+    PatternRunStatus status = PATTERN_RUN_OVER;
+    for (uint32_t run = 0; status == PATTERN_RUN_OVER && !budget_exhausted(budget); ++run) {
+        local.restarts += run > 0;
+        status = run_pattern_search(&search, restart_run_checks(&schedule, run), budget, rng, out, &local);
+    }
+
+    if (stats) {
+        stats->grids += local.grids;
+        stats->pruned += local.pruned;
+        stats->restarts += local.restarts;
+    }
+    return status == PATTERN_FOUND;
+}
+
+
+bool generate_sudoku_with_pattern_parallel(const FieldSubset* pattern, uint32_t threads, double max_seconds, uint64_t seed, Sudoku* out, PatternStats* stats) {
+#ifdef _OPENMP
+    if (threads == 0)
+        threads = (uint32_t) omp_get_max_threads();
+#else
+    threads = 1;
+#endif
+    CancelFlag found;
+    budget_reset_cancel(&found);
+    bool success = false;
+
+#pragma omp parallel num_threads(threads)
+    {
+        uint32_t thread = 0;
+#ifdef _OPENMP
+        thread = (uint32_t) omp_get_thread_num();
+#endif
+        Rng rng;
+        rng_seed(&rng, seed + thread);
+        SearchBudget budget;
+        budget_init(&budget);
+        if (max_seconds > 0.0)
+            budget_set_seconds(&budget, max_seconds);
+        budget.cancel = &found;
+
+        Sudoku instance;
+        PatternStats local = {0, 0, 0};
+        bool thread_success = generate_sudoku_with_pattern(pattern, &budget, &rng, &instance, &local);
+#pragma omp critical(pattern_result)
+        {
+            if (thread_success && !success) {
+                success = true;
+                *out = instance;
+                budget_cancel(&found);
+            }
+            if (stats) {
+                stats->grids += local.grids;
+                stats->pruned += local.pruned;
+                stats->restarts += local.restarts;
+            }
+        }
+    }
+    return success;
+}
@@ -0,0 +1,41 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "sudoku.h"
+#include "field_subset.h"
+#include "budget.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// instances whose hints lie exactly on a given pattern, e.g. a layout handed in by a designer
+// a randomized depth-first search fills solution grids field by field in row-major order, the instance is the grid
+// restricted to the pattern, which is unique iff every unavoidable set of the grid has a field in the pattern
+// (an unavoidable set is a set of fields whose digits can be permuted into another valid grid)
+// partial grids are pruned as soon as they complete an unavoidable set outside of the pattern: rectangles of two digits
+// in two rows and two columns are checked for every field, larger sets of two digits whenever a row is complete
+// after a grid whose instance is not unique, or a set found at the end of a row, the search backjumps to the last field
+// of the unavoidable set, since changing the fields after it cannot help
+// the search restarts from an empty grid on a luby schedule, so that the first rows are not stuck with a bad choice
+
+typedef struct {
+    // complete grids whose instance was checked for uniqueness
+    uint64_t grids;
+    // partial grids rejected because they completed an unavoidable set outside of the pattern
+    uint64_t pruned;
+    uint64_t restarts;
+} PatternStats;
+
+// returns false if the budget is exhausted before an instance is found, if no grid yields a unique instance on the pattern
+// or if the pattern has fewer than MIN_UNIQUE_HINTS fields
+// every field placed counts as a node and every uniqueness check as a check of the budget
+// stats may be NULL, otherwise the counts of this search are added
+bool generate_sudoku_with_pattern(const FieldSubset* pattern, SearchBudget* budget, Rng* rng, Sudoku* out, PatternStats* stats);
+
+// independent searches on the given number of threads (0 uses all cores), the first instance found ends all of them
+// each thread seeds its random number generator from seed and its thread number
+// stats may be NULL, otherwise the counts of all threads are added
+// max_seconds of 0 or less means no time limit
+bool generate_sudoku_with_pattern_parallel(const FieldSubset* pattern, uint32_t threads, double max_seconds, uint64_t seed, Sudoku* out, PatternStats* stats);
+
+#endif
@@ -0,0 +1,482 @@
+#include "pipeline.h"
+#include "generator.h"
+#include "bandit.h"
+#include "monotonic.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CACHE_LINE 64u
+
+static const char* const STAGE_NAMES[PIPELINE_STAGES] = {"fill", "dig", "dedup", "write"};
+
+
+// bounded multi-producer multi-consumer queue after Dmitry Vyukov
+// the sequence number of a cell tells whether it is ready to be written (position) or read (position + 1)
+typedef struct {
+    atomic_size_t sequence;
+    Sudoku sudoku;
+} QueueCell;
+
+typedef struct {
+    QueueCell* cells;
+    size_t mask;
+    // producers and consumers update the positions concurrently, keep them on separate cache lines
+    char padding_enqueue[CACHE_LINE];
+    atomic_size_t enqueue_position;
+    char padding_dequeue[CACHE_LINE];
+    atomic_size_t dequeue_position;
+    char padding_producers[CACHE_LINE];
+    // consumers stop once all producers are done and the queue is drained
+    atomic_uint open_producers;
+} Queue;
+
+typedef struct {
+    PipelineConfig config;
+    Queue grids;
+    Queue puzzles;
+    Queue unique;
+    // fill threads claim instances one by one until num_instances are claimed
+    atomic_uint_fast64_t claimed;
+    // set if a stage could not be started, all threads return as soon as possible
+    // also cancels the searches of the dig threads
+    CancelFlag aborted;
+} Pipeline;
+
+typedef struct {
+    Pipeline* pipeline;
+    PipelineStage stage;
+    uint32_t index;
+    uint64_t items;
+    uint64_t duplicates;
+    double busy_seconds;
+    double starved_seconds;
+    double blocked_seconds;
+} Worker;
+
+
+PipelineConfig pipeline_default_config() {
+    PipelineConfig config;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    config.num_instances = 1;
+    config.fill_threads = 1;
+    // grids are cheap compared to digging, the remaining cores dig
+    config.dig_threads = cores > 2 ? (uint32_t) cores - 1 : 1;
+    config.dedup = false;
+    config.queue_capacity = 256;
+    config.generation = sudokugen_default_config();
+    config.seed = (uint64_t) time(NULL);
+    config.out = stdout;
+    return config;
+}
+
+
+bool queue_init(Queue* queue, uint32_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    queue->cells = malloc(size * sizeof(QueueCell));
+    if (!queue->cells)
+        return false;
+    for (size_t i = 0; i < size; ++i) {
+        atomic_init(&queue->cells[i].sequence, i);
+    }
+    queue->mask = size - 1;
+    atomic_init(&queue->enqueue_position, 0);
+    atomic_init(&queue->dequeue_position, 0);
+    atomic_init(&queue->open_producers, 0);
+    return true;
+}
+
+
+void queue_destroy(Queue* queue) {
+    free(queue->cells);
+}
+
+
+// returns false if the queue is full
+bool queue_try_push(Queue* queue, const Sudoku* sudoku) {
+    size_t position = atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+    while (true) {
+        QueueCell* cell = queue->cells + (position & queue->mask);
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) position;
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->enqueue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                cell->sudoku = *sudoku;
+                atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+        }
+    }
+}
+
+
+// returns false if the queue is empty
+bool queue_try_pop(Queue* queue, Sudoku* sudoku) {
+    size_t position = atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);
+    while (true) {
+        QueueCell* cell = queue->cells + (position & queue->mask);
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t difference = (ptrdiff_t) sequence - (ptrdiff_t) (position + 1);
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->dequeue_position, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                *sudoku = cell->sudoku;
+                atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);
+        }
+    }
+}
+
+
+// spin briefly, then yield, then sleep, so that idle threads leave the cores to the busy stages
+void wait_briefly(uint32_t attempt) {
+    if (attempt < 16) {
+        return;
+    } else if (attempt < 64) {
+        sched_yield();
+    } else {
+        struct timespec pause = {.tv_sec = 0, .tv_nsec = 50000};
+        nanosleep(&pause, NULL);
+    }
+}
+
+
+// returns false if the pipeline was aborted
+bool queue_push_wait(Pipeline* pipeline, Queue* queue, const Sudoku* sudoku, double* waited) {
+    if (queue_try_push(queue, sudoku))
+        return true;
+    double start = monotonic_seconds();
+    for (uint32_t attempt = 0; !queue_try_push(queue, sudoku); ++attempt) {
+        if (atomic_load(&pipeline->aborted)) {
+            *waited += monotonic_seconds() - start;
+            return false;
+        }
+        wait_briefly(attempt);
+    }
+    *waited += monotonic_seconds() - start;
+    return true;
+}
+
+
+// returns false once all producers are done and the queue is drained, or if the pipeline was aborted
+bool queue_pop_wait(Pipeline* pipeline, Queue* queue, Sudoku* sudoku, double* waited) {
+    if (queue_try_pop(queue, sudoku))
+        return true;
+    double start = monotonic_seconds();
+    bool success = true;
+    for (uint32_t attempt = 0; !queue_try_pop(queue, sudoku); ++attempt) {
+        if (atomic_load(&pipeline->aborted)) {
+            success = false;
+            break;
+        }
+        // every push happens before its producer is closed, so one more attempt sees all of them
+        if (atomic_load(&queue->open_producers) == 0) {
+            success = queue_try_pop(queue, sudoku);
+            break;
+        }
+        wait_briefly(attempt);
+    }
+    *waited += monotonic_seconds() - start;
+    return success;
+}
+
+
+void* fill_thread(void* raw_worker) {
+    Worker* worker = raw_worker;
+    Pipeline* pipeline = worker->pipeline;
+    Rng rng;
+    rng_seed(&rng, pipeline->config.seed + ((uint64_t) PIPELINE_FILL << 32u) + worker->index);
+
+    while (atomic_fetch_add(&pipeline->claimed, 1) < pipeline->config.num_instances) {
+        double start = monotonic_seconds();
+        Sudoku grid = sudoku_new_empty();
+        sudoku_solve_random(&grid, &rng);
+        worker->busy_seconds += monotonic_seconds() - start;
+        ++worker->items;
+        if (!queue_push_wait(pipeline, &pipeline->grids, &grid, &worker->blocked_seconds))
+            break;
+    }
+    atomic_fetch_sub(&pipeline->grids.open_producers, 1);
+    return NULL;
+}
+
+
+void* dig_thread(void* raw_worker) {
+    Worker* worker = raw_worker;
+    Pipeline* pipeline = worker->pipeline;
+    Rng rng;
+    rng_seed(&rng, pipeline->config.seed + ((uint64_t) PIPELINE_DIG << 32u) + worker->index);
+
+    // a bandit is not thread-safe, so every thread learns with a copy of its own
+    void* heuristic_state = pipeline->config.generation.heuristic_state;
+    BanditHeuristic local_bandit;
+    if (pipeline->config.generation.heuristic == bandit_heuristic) {
+        local_bandit = *(BanditHeuristic*) heuristic_state;
+        rng_seed(&local_bandit.rng, pipeline->config.seed + worker->index);
+        heuristic_state = &local_bandit;
+    }
+
+    Sudoku grid;
+    while (queue_pop_wait(pipeline, &pipeline->grids, &grid, &worker->starved_seconds)) {
+        double start = monotonic_seconds();
+        Sudoku puzzle;
+        bool found = sudokugen_search(&pipeline->config.generation, heuristic_state, &grid, &pipeline->aborted, &rng, NULL, &puzzle);
+        worker->busy_seconds += monotonic_seconds() - start;
+        ++worker->items;
+        if (atomic_load(&pipeline->aborted))
+            break;
+        // exact_hints ran out of searches, the instance is missing from the output
+        if (!found)
+            continue;
+        if (!queue_push_wait(pipeline, &pipeline->puzzles, &puzzle, &worker->blocked_seconds))
+            break;
+    }
+    atomic_fetch_sub(&pipeline->puzzles.open_producers, 1);
+    return NULL;
+}
+
+
+// open addressing over the instances written so far, an entry starting with 0 is free
+typedef struct {
+    char (*entries)[SUDOKUGEN_CHARS_PER_INSTANCE];
+    size_t mask;
+    size_t size;
+} InstanceSet;
+
+
+uint64_t hash_instance(const char* instance) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t i = 0; i < SUDOKUGEN_CHARS_PER_INSTANCE; ++i) {
+        hash = (hash ^ (uint8_t) instance[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+
+bool instance_set_init(InstanceSet* set, size_t capacity) {
+    set->entries = calloc(capacity, sizeof(*set->entries));
+    set->mask = capacity - 1;
+    set->size = 0;
+    return set->entries != NULL;
+}
+
+
+// returns false if the instance was contained already
+bool instance_set_insert(InstanceSet* set, const char* instance) {
+    // keep the load factor at or below 1/2
+    if (2 * (set->size + 1) > set->mask + 1) {
+        InstanceSet grown;
+        if (instance_set_init(&grown, 2 * (set->mask + 1))) {
+            for (size_t i = 0; i <= set->mask; ++i) {
+                if (set->entries[i][0])
+                    instance_set_insert(&grown, set->entries[i]);
+            }
+            free(set->entries);
+            *set = grown;
+        }
+    }
+    size_t slot = hash_instance(instance) & set->mask;
+    while (set->entries[slot][0]) {
+        if (memcmp(set->entries[slot], instance, SUDOKUGEN_CHARS_PER_INSTANCE) == 0)
+            return false;
+        slot = (slot + 1) & set->mask;
+    }
+    memcpy(set->entries[slot], instance, SUDOKUGEN_CHARS_PER_INSTANCE);
+    ++set->size;
+    return true;
+}
+
+
+void* dedup_thread(void* raw_worker) {
+    Worker* worker = raw_worker;
+    Pipeline* pipeline = worker->pipeline;
+    InstanceSet seen;
+    if (!instance_set_init(&seen, 1024)) {
+        budget_cancel(&pipeline->aborted);
+        atomic_fetch_sub(&pipeline->unique.open_producers, 1);
+        return NULL;
+    }
+
+    Sudoku puzzle;
+    char instance[SUDOKUGEN_CHARS_PER_INSTANCE];
+    while (queue_pop_wait(pipeline, &pipeline->puzzles, &puzzle, &worker->starved_seconds)) {
+        double start = monotonic_seconds();
+        sudoku_to_string(&puzzle, instance);
+        bool unique = instance_set_insert(&seen, instance);
+        worker->busy_seconds += monotonic_seconds() - start;
+        ++worker->items;
+        if (!unique) {
+            ++worker->duplicates;
+            continue;
+        }
+        if (!queue_push_wait(pipeline, &pipeline->unique, &puzzle, &worker->blocked_seconds))
+            break;
+    }
+    free(seen.entries);
+    atomic_fetch_sub(&pipeline->unique.open_producers, 1);
+    return NULL;
+}
+
+
+void write_stage(Worker* worker, Queue* input, PipelineStats* stats) {
+    Pipeline* pipeline = worker->pipeline;
+    char line[SUDOKUGEN_CHARS_PER_INSTANCE + 1];
+    line[SUDOKUGEN_CHARS_PER_INSTANCE] = '\n';
+
+    Sudoku puzzle;
+    while (queue_pop_wait(pipeline, input, &puzzle, &worker->starved_seconds)) {
+        double start = monotonic_seconds();
+        TRACE_BEGIN(span);
+        sudoku_to_string(&puzzle, line);
+        fwrite(line, 1, sizeof(line), pipeline->config.out);
+        TRACE_END(span, "write");
+        worker->busy_seconds += monotonic_seconds() - start;
+        ++worker->items;
+        stats->hints_written += 81 - puzzle.blank_fields;
+    }
+    fflush(pipeline->config.out);
+    stats->instances_written = worker->items;
+}
+
+
+// registers every thread as a producer of its output queue before it starts, so that consumers never stop early
+// returns the number of threads started
+uint32_t start_stage(Pipeline* pipeline, PipelineStage stage, void* (*run)(void*), Queue* output, Worker* workers, pthread_t* threads, uint32_t count) {
+    uint32_t started = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        Worker* worker = workers + started;
+        memset(worker, 0, sizeof(Worker));
+        worker->pipeline = pipeline;
+        worker->stage = stage;
+        worker->index = started;
+        atomic_fetch_add(&output->open_producers, 1);
+        if (pthread_create(threads + started, NULL, run, worker) != 0) {
+            atomic_fetch_sub(&output->open_producers, 1);
+            continue;
+        }
+        ++started;
+    }
+    return started;
+}
+
+
+bool pipeline_run(const PipelineConfig* config, PipelineStats* stats) {
+    memset(stats, 0, sizeof(PipelineStats));
+    if (config->fill_threads == 0 || config->dig_threads == 0)
+        return false;
+
+    Pipeline* pipeline = calloc(1, sizeof(Pipeline));
+    uint32_t max_threads = config->fill_threads + config->dig_threads + 2;
+    Worker* workers = calloc(max_threads, sizeof(Worker));
+    pthread_t* threads = calloc(max_threads, sizeof(pthread_t));
+    bool queues = pipeline && queue_init(&pipeline->grids, config->queue_capacity);
+    queues = queues && queue_init(&pipeline->puzzles, config->queue_capacity);
+    queues = queues && queue_init(&pipeline->unique, config->queue_capacity);
+    if (!queues || !workers || !threads) {
+        if (pipeline) {
+            queue_destroy(&pipeline->grids);
+            queue_destroy(&pipeline->puzzles);
+            queue_destroy(&pipeline->unique);
+        }
+        free(pipeline);
+        free(workers);
+        free(threads);
+        return false;
+    }
+    pipeline->config = *config;
+    atomic_init(&pipeline->claimed, 0);
+    atomic_init(&pipeline->aborted, 0);
+
+    // upstream stages first, every stage needs at least one thread
+    double start = monotonic_seconds();
+    uint32_t counts[PIPELINE_STAGES] = {0};
+    uint32_t started = 0;
+    counts[PIPELINE_FILL] = start_stage(pipeline, PIPELINE_FILL, fill_thread, &pipeline->grids, workers, threads, config->fill_threads);
+    started += counts[PIPELINE_FILL];
+    if (counts[PIPELINE_FILL] > 0) {
+        counts[PIPELINE_DIG] = start_stage(pipeline, PIPELINE_DIG, dig_thread, &pipeline->puzzles, workers + started, threads + started, config->dig_threads);
+        started += counts[PIPELINE_DIG];
+    }
+    if (counts[PIPELINE_DIG] > 0 && config->dedup) {
+        counts[PIPELINE_DEDUP] = start_stage(pipeline, PIPELINE_DEDUP, dedup_thread, &pipeline->unique, workers + started, threads + started, 1);
+        started += counts[PIPELINE_DEDUP];
+    }
+    bool success = counts[PIPELINE_DIG] > 0 && (!config->dedup || counts[PIPELINE_DEDUP] > 0);
+
+    Worker* writer = workers + started;
+    memset(writer, 0, sizeof(Worker));
+    writer->pipeline = pipeline;
+    writer->stage = PIPELINE_WRITE;
+    if (success) {
+        counts[PIPELINE_WRITE] = 1;
+        write_stage(writer, config->dedup ? &pipeline->unique : &pipeline->puzzles, stats);
+    } else {
+        budget_cancel(&pipeline->aborted);
+    }
+
+    for (uint32_t i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    stats->wall_seconds = monotonic_seconds() - start;
+    success &= !atomic_load(&pipeline->aborted);
+
+    for (uint32_t i = 0; i <= started; ++i) {
+        PipelineStageStats* stage = stats->stages + workers[i].stage;
+        stage->items += workers[i].items;
+        stage->busy_seconds += workers[i].busy_seconds;
+        stage->starved_seconds += workers[i].starved_seconds;
+        stage->blocked_seconds += workers[i].blocked_seconds;
+        stats->duplicates += workers[i].duplicates;
+    }
+    for (uint32_t s = 0; s < PIPELINE_STAGES; ++s) {
+        stats->stages[s].threads = counts[s];
+    }
+
+    queue_destroy(&pipeline->grids);
+    queue_destroy(&pipeline->puzzles);
+    queue_destroy(&pipeline->unique);
+    free(pipeline);
+    free(workers);
+    free(threads);
+    return success;
+}
+
+
+void pipeline_print_stats(const PipelineStats* stats, FILE* out) {
+    double per_second = stats->wall_seconds > 0.0 ? (double) stats->instances_written / stats->wall_seconds : 0.0;
+    double mean_hints = stats->instances_written > 0 ? (double) stats->hints_written / (double) stats->instances_written : 0.0;
+    fprintf(out, "%llu instances in %.2f s (%.1f per second), mean hints %.2f, %llu duplicates dropped\n",
+            (unsigned long long) stats->instances_written, stats->wall_seconds, per_second, mean_hints,
+            (unsigned long long) stats->duplicates);
+    fprintf(out, "stage    threads      items     busy  starved  blocked\n");
+    for (uint32_t s = 0; s < PIPELINE_STAGES; ++s) {
+        const PipelineStageStats* stage = stats->stages + s;
+        if (stage->threads == 0)
+            continue;
+        double thread_seconds = stage->threads * stats->wall_seconds;
+        if (thread_seconds <= 0.0)
+            thread_seconds = 1.0;
+        fprintf(out, "%-8s %7u %10llu %7.1f%% %7.1f%% %7.1f%%\n", STAGE_NAMES[s], stage->threads,
+                (unsigned long long) stage->items, 100.0 * stage->busy_seconds / thread_seconds,
+                100.0 * stage->starved_seconds / thread_seconds, 100.0 * stage->blocked_seconds / thread_seconds);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "sudokugen.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// generation split into stages that run on their own threads
+// fill: random solved grids -> dig: clear hints -> dedup (optional) -> write
+// neighboring stages are connected by bounded lock-free queues
+// a full queue stalls its producers, an empty queue stalls its consumers
+// the per-stage statistics show which stage limits the throughput and should get more threads
+
+typedef enum {
+    PIPELINE_FILL,
+    PIPELINE_DIG,
+    PIPELINE_DEDUP,
+    PIPELINE_WRITE,
+    PIPELINE_STAGES
+} PipelineStage;
+
+typedef struct {
+    uint64_t num_instances;
+    uint32_t fill_threads;
+    uint32_t dig_threads;
+    // drop instances that have been written before, runs on a thread of its own
+    bool dedup;
+    // capacity of every queue, rounded up to a power of two
+    uint32_t queue_capacity;
+    // strategy and parameters of the dig stage, the heuristic is shared by all dig threads and must be thread-safe
+    // except for bandit_heuristic, every dig thread learns with a copy of the bandit
+    // with exact_hints, a dig thread searches from grids of its own until one reaches the count, see sudokugen_search
+    // grids that run out of exact_max_searches are dropped, so fewer than num_instances instances may be written
+    SudokuGenConfig generation;
+    uint64_t seed;
+    // instances are written as lines of SUDOKUGEN_CHARS_PER_INSTANCE characters, the write stage runs on the calling thread
+    FILE* out;
+} PipelineConfig;
+
+typedef struct {
+    uint32_t threads;
+    // instances taken out of the stage, duplicates included
+    uint64_t items;
+    // summed over all threads of the stage
+    double busy_seconds;
+    // waiting for the input queue to fill
+    double starved_seconds;
+    // waiting for room in the output queue
+    double blocked_seconds;
+} PipelineStageStats;
+
+typedef struct {
+    double wall_seconds;
+    uint64_t instances_written;
+    uint64_t hints_written;
+    uint64_t duplicates;
+    PipelineStageStats stages[PIPELINE_STAGES];
+} PipelineStats;
+
+PipelineConfig pipeline_default_config();
+
+// returns false if the threads or queues could not be set up
+bool pipeline_run(const PipelineConfig* config, PipelineStats* stats);
+
+// one line per stage: threads, items, and busy, starved and blocked time relative to the stage's thread time
+void pipeline_print_stats(const PipelineStats* stats, FILE* out);
+
+#endif
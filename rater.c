@@ -0,0 +1,519 @@
+#include "rater.h"
+#include "units.h"
+#include "utils.h"
+
+#include <stdbool.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const char* RATING_NAMES[RATING_LEVELS] = {
+    "unrated", "hidden singles", "naked singles", "locked candidates", "subsets", "fish", "chains", "trial"
+};
+
+// 9 bit masks of candidates and placed digits, more compact than the Sudoku layout which the techniques would not use
+typedef struct {
+    uint16_t candidates[81];
+    uint16_t values[81];
+    uint32_t unsolved;
+    // units and digits whose candidates changed since the last search for subsets, fish and colorings respectively
+    // searches that found nothing are only repeated where something changed
+    uint32_t subset_units;
+    uint16_t fish_digits;
+    uint16_t coloring_digits;
+} Grid;
+
+
+void grid_changed(Grid* grid, uint32_t field, uint16_t removed) {
+    grid->subset_units |= (1u << FIELD_UNITS[field][0]) | (1u << FIELD_UNITS[field][1]) | (1u << FIELD_UNITS[field][2]);
+    grid->fish_digits |= removed;
+    grid->coloring_digits |= removed;
+}
+
+
+void grid_place(Grid* grid, uint32_t field, uint16_t digit) {
+    grid_changed(grid, field, grid->candidates[field]);
+    grid->values[field] = digit;
+    grid->candidates[field] = 0;
+    --grid->unsolved;
+    for (uint32_t i = 0; i < PEER_COUNT; ++i) {
+        uint32_t peer = FIELD_PEERS[field][i];
+        if (grid->candidates[peer] & digit) {
+            grid->candidates[peer] &= ~digit;
+            grid_changed(grid, peer, digit);
+        }
+    }
+}
+
+
+// returns false if the hints contradict each other
+bool grid_init(Grid* grid, const char* instance) {
+    for (uint32_t i = 0; i < 81u; ++i) {
+        grid->candidates[i] = ALL_CANDIDATES;
+        grid->values[i] = 0;
+    }
+    grid->unsolved = 81;
+    // everything changes, so the hints are placed without tracking
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (instance[i] < '1' || instance[i] > '9')
+            continue;
+        uint16_t digit = (uint16_t) (1u << (instance[i] - '1'));
+        if (!(grid->candidates[i] & digit))
+            return false;
+        grid->values[i] = digit;
+        grid->candidates[i] = 0;
+        --grid->unsolved;
+        for (uint32_t k = 0; k < PEER_COUNT; ++k) {
+            grid->candidates[FIELD_PEERS[i][k]] &= ~digit;
+        }
+    }
+    grid->subset_units = (1u << UNIT_COUNT) - 1;
+    grid->fish_digits = grid->coloring_digits = ALL_CANDIDATES;
+    return true;
+}
+
+
+// returns true if any of the digits was a candidate of the field
+bool grid_eliminate(Grid* grid, uint32_t field, uint16_t digits) {
+    uint16_t removed = grid->candidates[field] & digits;
+    if (!removed)
+        return false;
+    grid->candidates[field] &= ~digits;
+    grid_changed(grid, field, removed);
+    return true;
+}
+
+
+bool sees(uint32_t a, uint32_t b) {
+    return a != b && (FIELD_UNITS[a][0] == FIELD_UNITS[b][0] || FIELD_UNITS[a][1] == FIELD_UNITS[b][1] || FIELD_UNITS[a][2] == FIELD_UNITS[b][2]);
+}
+
+
+// population_count is a library call without a popcnt instruction, too slow for the subset searches
+uint32_t digit_count(uint16_t digits) {
+    uint32_t bits = digits - ((digits >> 1) & 0x5555u);
+    bits = (bits & 0x3333u) + ((bits >> 2) & 0x3333u);
+    bits = (bits + (bits >> 4)) & 0x0f0fu;
+    return (bits + (bits >> 8)) & 0x1fu;
+}
+
+
+uint16_t lowest_digit(uint16_t digits) {
+    return (uint16_t) (digits & (~digits + 1u));
+}
+
+
+bool apply_hidden_singles(Grid* grid) {
+    bool progress = false;
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        const uint8_t* fields = UNIT_FIELDS[unit];
+        uint16_t once = 0, twice = 0;
+        for (uint32_t k = 0; k < 9; ++k) {
+            uint16_t candidates = grid->candidates[fields[k]];
+            twice |= once & candidates;
+            once |= candidates;
+        }
+        once &= ~twice;
+        while (once) {
+            uint16_t digit = lowest_digit(once);
+            once &= ~digit;
+            for (uint32_t k = 0; k < 9; ++k) {
+                if (grid->candidates[fields[k]] & digit) {
+                    grid_place(grid, fields[k], digit);
+                    progress = true;
+                    break;
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+
+bool apply_naked_singles(Grid* grid) {
+    bool progress = false;
+    for (uint32_t i = 0; i < 81u; ++i) {
+        uint16_t candidates = grid->candidates[i];
+        if (candidates && !(candidates & (candidates - 1))) {
+            grid_place(grid, i, candidates);
+            progress = true;
+        }
+    }
+    return progress;
+}
+
+
+// bit k of places[d]: digit d + 1 is a candidate of field k of the unit
+void unit_places(const Grid* grid, uint32_t unit, uint16_t places[9]) {
+    for (uint32_t d = 0; d < 9; ++d) {
+        places[d] = 0;
+    }
+    // branch-free, the candidates are too irregular for the branch predictor
+    for (uint32_t k = 0; k < 9; ++k) {
+        uint32_t candidates = grid->candidates[UNIT_FIELDS[unit][k]];
+        for (uint32_t d = 0; d < 9; ++d) {
+            places[d] |= ((candidates >> d) & 1u) << k;
+        }
+    }
+}
+
+
+// bit k of places[unit]: digit d + 1 is a candidate of field k of the unit, for all units at once
+void digit_places(const Grid* grid, uint32_t d, uint16_t places[UNIT_COUNT]) {
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        places[unit] = 0;
+    }
+    for (uint32_t field = 0; field < 81u; ++field) {
+        uint32_t row = field / 9, column = field % 9;
+        uint32_t bit = (grid->candidates[field] >> d) & 1u;
+        places[row] |= bit << column;
+        places[9 + column] |= bit << row;
+        places[FIELD_UNITS[field][2]] |= bit << (row % 3 * 3 + column % 3);
+    }
+}
+
+
+// all places of a digit within a row or column lie in one square, or all places within a square lie in one row or column
+// the digit is then eliminated from the rest of the other unit, which is called claiming and pointing respectively
+// works on the segments where a line crosses a square, for all digits at once
+bool apply_locked_candidates(Grid* grid) {
+    bool progress = false;
+    for (uint32_t type = 0; type < 2; ++type) {
+        // candidates of the 3 fields of every line in each of its squares
+        uint16_t segments[9][3];
+        for (uint32_t line = 0; line < 9; ++line) {
+            const uint8_t* fields = UNIT_FIELDS[type * 9 + line];
+            for (uint32_t s = 0; s < 3; ++s) {
+                segments[line][s] = grid->candidates[fields[3 * s]] | grid->candidates[fields[3 * s + 1]] | grid->candidates[fields[3 * s + 2]];
+            }
+        }
+        for (uint32_t line = 0; line < 9; ++line) {
+            // the other two lines through the same squares
+            uint32_t first = line - line % 3;
+            uint32_t others[2] = {first + (line + 1) % 3, first + (line + 2) % 3};
+            for (uint32_t s = 0; s < 3; ++s) {
+                uint16_t segment = segments[line][s];
+                // confined to the segment within the square, so they leave the rest of the line
+                uint16_t pointing = segment & ~(segments[others[0]][s] | segments[others[1]][s]);
+                // confined to the segment within the line, so they leave the rest of the square
+                uint16_t claiming = segment & ~(segments[line][(s + 1) % 3] | segments[line][(s + 2) % 3]);
+                if (pointing) {
+                    for (uint32_t k = 0; k < 9; ++k) {
+                        if (k / 3 != s)
+                            progress |= grid_eliminate(grid, UNIT_FIELDS[type * 9 + line][k], pointing);
+                    }
+                }
+                if (claiming) {
+                    for (uint32_t k = 3 * s; k < 3 * s + 3; ++k) {
+                        progress |= grid_eliminate(grid, UNIT_FIELDS[type * 9 + others[0]][k], claiming);
+                        progress |= grid_eliminate(grid, UNIT_FIELDS[type * 9 + others[1]][k], claiming);
+                    }
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+
+typedef struct {
+    uint32_t count;
+    // chosen items and the union of their bits
+    uint16_t subsets[246];
+    uint16_t unions[246];
+} SubsetMatches;
+
+
+// collects the subsets of 2 to max_size (at most 4) of the 9 items whose union has as many bits as the subset has items
+// only items with 2 to max_size bits can take part, and a subset is only extended while its union is small enough
+void collect_subsets(SubsetMatches* matches, const uint16_t items[9], uint32_t max_size) {
+    uint16_t values[9], ids[9];
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < 9; ++i) {
+        uint32_t bits = digit_count(items[i]);
+        if (bits >= 2 && bits <= max_size) {
+            values[n] = items[i];
+            ids[n++] = (uint16_t) (1u << i);
+        }
+    }
+
+    matches->count = 0;
+    for (uint32_t a = 0; a < n; ++a) {
+        for (uint32_t b = a + 1; b < n; ++b) {
+            uint16_t pair = values[a] | values[b];
+            uint32_t pair_bits = digit_count(pair);
+            if (pair_bits == 2) {
+                matches->subsets[matches->count] = ids[a] | ids[b];
+                matches->unions[matches->count++] = pair;
+                continue;
+            }
+            if (pair_bits > max_size)
+                continue;
+            for (uint32_t c = b + 1; c < n; ++c) {
+                uint16_t triple = pair | values[c];
+                uint32_t triple_bits = digit_count(triple);
+                if (triple_bits == 3) {
+                    matches->subsets[matches->count] = ids[a] | ids[b] | ids[c];
+                    matches->unions[matches->count++] = triple;
+                    continue;
+                }
+                if (triple_bits > max_size)
+                    continue;
+                for (uint32_t d = c + 1; d < n; ++d) {
+                    uint16_t quadruple = triple | values[d];
+                    if (digit_count(quadruple) == 4) {
+                        matches->subsets[matches->count] = ids[a] | ids[b] | ids[c] | ids[d];
+                        matches->unions[matches->count++] = quadruple;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+// naked subsets: n fields of a unit with only n candidates between them, which are eliminated from the other fields
+// hidden subsets: n digits with only n places in a unit, where all other candidates are eliminated
+// a naked subset of n out of the m open fields of a unit and the hidden subset of the other m - n digits are the same
+// and make the same eliminations, so naked subsets are searched up to half the open fields and hidden ones below that
+bool apply_subsets(Grid* grid) {
+    bool progress = false;
+    uint32_t units = grid->subset_units;
+    grid->subset_units = 0;
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        if (!(units & (1u << unit)))
+            continue;
+        const uint8_t* fields = UNIT_FIELDS[unit];
+        uint16_t candidates[9];
+        uint32_t open_count = 0;
+        for (uint32_t k = 0; k < 9; ++k) {
+            candidates[k] = grid->candidates[fields[k]];
+            open_count += candidates[k] != 0;
+        }
+        uint32_t max_naked = min(4, open_count / 2);
+        uint32_t max_hidden = min(4, open_count - 1 - open_count / 2);
+        if (max_naked < 2)
+            continue;
+
+        SubsetMatches matches;
+        collect_subsets(&matches, candidates, max_naked);
+        for (uint32_t m = 0; m < matches.count; ++m) {
+            for (uint32_t k = 0; k < 9; ++k) {
+                if (!(matches.subsets[m] & (1u << k)))
+                    progress |= grid_eliminate(grid, fields[k], matches.unions[m]);
+            }
+        }
+
+        if (max_hidden < 2)
+            continue;
+        uint16_t places[9];
+        unit_places(grid, unit, places);
+        collect_subsets(&matches, places, max_hidden);
+        for (uint32_t m = 0; m < matches.count; ++m) {
+            for (uint32_t k = 0; k < 9; ++k) {
+                if (matches.unions[m] & (1u << k))
+                    progress |= grid_eliminate(grid, fields[k], (uint16_t) (ALL_CANDIDATES & ~matches.subsets[m]));
+            }
+        }
+    }
+    return progress;
+}
+
+
+// n rows whose places of a digit lie in only n columns, which eliminates the digit from the rest of these columns
+// and the same with rows and columns swapped: x-wing (2), swordfish (3), jellyfish (4)
+bool apply_fish(Grid* grid) {
+    bool progress = false;
+    uint16_t digits = grid->fish_digits;
+    grid->fish_digits = 0;
+    for (uint32_t d = 0; d < 9; ++d) {
+        uint16_t digit = (uint16_t) (1u << d);
+        if (!(digits & digit))
+            continue;
+        // the rows and columns among them are the places of the digit on the base lines
+        uint16_t places[UNIT_COUNT];
+        digit_places(grid, d, places);
+        for (uint32_t base_type = 0; base_type < 2; ++base_type) {
+            SubsetMatches matches;
+            collect_subsets(&matches, places + base_type * 9, 4);
+            for (uint32_t m = 0; m < matches.count; ++m) {
+                for (uint32_t k = 0; k < 9; ++k) {
+                    if (!(matches.unions[m] & (1u << k)))
+                        continue;
+                    // field i of cover line k lies on base line i
+                    for (uint32_t i = 0; i < 9; ++i) {
+                        if (!(matches.subsets[m] & (1u << i)))
+                            progress |= grid_eliminate(grid, UNIT_FIELDS[(1 - base_type) * 9 + k][i], digit);
+                    }
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+
+// a pivot with candidates xy sees two pincers with xz and yz, so every field seeing both pincers cannot be z
+bool apply_xy_wing(Grid* grid) {
+    bool progress = false;
+    for (uint32_t pivot = 0; pivot < 81u; ++pivot) {
+        uint16_t xy = grid->candidates[pivot];
+        if (population_count(xy) != 2)
+            continue;
+        for (uint32_t i = 0; i < PEER_COUNT; ++i) {
+            uint32_t first = FIELD_PEERS[pivot][i];
+            uint16_t xz = grid->candidates[first];
+            if (population_count(xz) != 2 || population_count(xz & xy) != 1)
+                continue;
+            uint16_t z = xz & ~xy;
+            uint16_t yz = (xy & ~xz) | z;
+            for (uint32_t j = 0; j < PEER_COUNT; ++j) {
+                uint32_t second = FIELD_PEERS[pivot][j];
+                if (second == first || grid->candidates[second] != yz)
+                    continue;
+                for (uint32_t k = 0; k < PEER_COUNT; ++k) {
+                    uint32_t field = FIELD_PEERS[first][k];
+                    if (field != second && sees(field, second))
+                        progress |= grid_eliminate(grid, field, z);
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+
+// chains of conjugate pairs (the only two places of a digit in a unit) alternate between true and false
+// so either all fields of one color hold the digit or all fields of the other one
+// wrap: two fields of the same color see each other, so that color is false
+// trap: a field seeing both colors cannot hold the digit
+bool apply_simple_coloring(Grid* grid) {
+    bool progress = false;
+    uint16_t digits = grid->coloring_digits;
+    grid->coloring_digits = 0;
+    for (uint32_t d = 0; d < 9; ++d) {
+        uint16_t digit = (uint16_t) (1u << d);
+        if (!(digits & digit))
+            continue;
+        uint16_t places[UNIT_COUNT];
+        digit_places(grid, d, places);
+        // the two places of the digit in each unit if there are exactly two, 0xff otherwise
+        uint8_t partner[UNIT_COUNT][2];
+        for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+            if (population_count(places[unit]) == 2) {
+                partner[unit][0] = UNIT_FIELDS[unit][lowest_set_bit_index(places[unit])];
+                partner[unit][1] = UNIT_FIELDS[unit][highest_set_bit_index(places[unit])];
+            } else {
+                partner[unit][0] = partner[unit][1] = 0xff;
+            }
+        }
+
+        // the fields where the digit is still a candidate
+        uint8_t open_fields[81];
+        uint32_t open_count = 0;
+        for (uint32_t field = 0; field < 81u; ++field) {
+            if (grid->candidates[field] & digit)
+                open_fields[open_count++] = (uint8_t) field;
+        }
+
+        // 0: uncolored, otherwise 2 * component + color + 1
+        uint8_t colors[81] = {0};
+        uint8_t chain[81];
+        uint32_t component = 0;
+        for (uint32_t o = 0; o < open_count; ++o) {
+            uint32_t start = open_fields[o];
+            if (colors[start])
+                continue;
+            // breadth-first search over the conjugate pairs
+            uint32_t chain_length = 0;
+            colors[start] = (uint8_t) (2 * component + 1);
+            chain[chain_length++] = (uint8_t) start;
+            for (uint32_t n = 0; n < chain_length; ++n) {
+                uint32_t field = chain[n];
+                for (uint32_t t = 0; t < 3; ++t) {
+                    const uint8_t* pair = partner[FIELD_UNITS[field][t]];
+                    if (pair[0] == 0xff)
+                        continue;
+                    uint32_t other = pair[0] == field ? pair[1] : pair[0];
+                    if (colors[other])
+                        continue;
+                    // the opposite color of the same component
+                    colors[other] = (uint8_t) (((colors[field] - 1) ^ 1u) + 1);
+                    chain[chain_length++] = (uint8_t) other;
+                }
+            }
+            uint32_t own = component++;
+            if (chain_length < 2)
+                continue;
+
+            // bit c: the field sees a field of color c of this component
+            uint8_t seen[81] = {0};
+            for (uint32_t n = 0; n < chain_length; ++n) {
+                uint8_t color_bit = (uint8_t) (1u << ((colors[chain[n]] - 1) & 1u));
+                for (uint32_t i = 0; i < PEER_COUNT; ++i) {
+                    seen[FIELD_PEERS[chain[n]][i]] |= color_bit;
+                }
+            }
+            for (uint32_t n = 0; n < chain_length; ++n) {
+                uint8_t false_color = colors[chain[n]];
+                if (!(seen[chain[n]] & (1u << ((false_color - 1) & 1u))))
+                    continue;
+                for (uint32_t m = 0; m < chain_length; ++m) {
+                    if (colors[chain[m]] == false_color)
+                        progress |= grid_eliminate(grid, chain[m], digit);
+                }
+                break;
+            }
+            for (uint32_t n = 0; n < open_count; ++n) {
+                uint32_t field = open_fields[n];
+                if (seen[field] == 3 && (!colors[field] || (colors[field] - 1u) / 2 != own))
+                    progress |= grid_eliminate(grid, field, digit);
+            }
+        }
+    }
+    return progress;
+}
+
+
+Rating rate_instance(const char* instance) {
+    Grid grid;
+    if (!grid_init(&grid, instance))
+        return RATING_UNRATED;
+
+    // restart with the easiest technique after every step
+    Rating hardest = RATING_HIDDEN_SINGLES;
+    while (grid.unsolved > 0) {
+        Rating used;
+        if (apply_hidden_singles(&grid))
+            used = RATING_HIDDEN_SINGLES;
+        else if (apply_naked_singles(&grid))
+            used = RATING_NAKED_SINGLES;
+        else if (apply_locked_candidates(&grid))
+            used = RATING_LOCKED_CANDIDATES;
+        else if (apply_subsets(&grid))
+            used = RATING_SUBSETS;
+        else if (apply_fish(&grid))
+            used = RATING_FISH;
+        else if (apply_xy_wing(&grid) || apply_simple_coloring(&grid))
+            used = RATING_CHAINS;
+        else
+            return RATING_TRIAL;
+        if (used > hardest)
+            hardest = used;
+    }
+    return hardest;
+}
+
+
+void rate_instances(const char* instances, uint8_t* ratings, uint32_t count) {
+#pragma omp parallel for schedule(static, 256)
+    for (int32_t i = 0; i < (int32_t) count; ++i) {
+        ratings[i] = (uint8_t) rate_instance(instances + (size_t) i * 81);
+    }
+}
+
+
+const char* rating_name(Rating rating) {
+    return rating < RATING_LEVELS ? RATING_NAMES[rating] : "invalid";
+}
@@ -0,0 +1,39 @@
+#ifndef RATER_H
+#define RATER_H
+
+#include <stdint.h>
+
+// rates instances by the hardest human solving technique they require
+// an instance is solved by applying the easiest technique that makes progress, over and over again
+// the rating is the hardest technique applied, so it only depends on the instance and not on the solving order
+// the values fit the difficulty levels of the puzzle store
+
+typedef enum {
+    // also used for instances with contradicting hints
+    RATING_UNRATED,
+    // a digit has a single place left in a row, column or square
+    RATING_HIDDEN_SINGLES,
+    // a field has a single candidate left
+    RATING_NAKED_SINGLES,
+    // pointing and claiming: the candidates of a digit in one unit all lie in another unit
+    RATING_LOCKED_CANDIDATES,
+    // naked and hidden pairs, triples and quadruples
+    RATING_SUBSETS,
+    // x-wing, swordfish and jellyfish
+    RATING_FISH,
+    // xy-wing and simple coloring
+    RATING_CHAINS,
+    // none of the techniques above suffice, trial and error is required
+    // instances without a unique solution end up here as well
+    RATING_TRIAL,
+    RATING_LEVELS
+} Rating;
+
+// instance as 81 characters '0'-'9'
+Rating rate_instance(const char* instance);
+// rates count instances of 81 characters each in parallel with OpenMP
+void rate_instances(const char* instances, uint8_t* ratings, uint32_t count);
+
+const char* rating_name(Rating rating);
+
+#endif
@@ -0,0 +1,394 @@
+#include "removal_search.h"
+#include "generator.h"
+#include "utils.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char CHECKPOINT_MAGIC[8] = "SDKCKP4";
+
+
+bool removal_sink_init(RemovalSink* sink, uint32_t max_hints, uint32_t diverge_levels, InstanceCallback callback, void* state) {
+    sink->max_hints = max_hints;
+    sink->diverge_levels = diverge_levels;
+    sink->callback = callback;
+    sink->state = state;
+    sink->emitted = 0;
+    sink->seen_mask = 255;
+    sink->seen = calloc(sink->seen_mask + 1, sizeof(FieldSubset));
+    return sink->seen != NULL;
+}
+
+
+void removal_sink_destroy(RemovalSink* sink) {
+    free(sink->seen);
+    sink->seen = NULL;
+}
+
+
+uint32_t hash_hints(const FieldSubset* hints) {
+    uint64_t hash = ((uint64_t) hints->bits[0] << 32u | hints->bits[1]) * 0x9e3779b97f4a7c15ull;
+    hash = (hash ^ hints->bits[2]) * 0xbf58476d1ce4e5b9ull;
+    return (uint32_t) (hash >> 32u);
+}
+
+
+bool is_empty_slot(const FieldSubset* slot) {
+    return !(slot->bits[0] | slot->bits[1] | slot->bits[2]);
+}
+
+
+// returns false if the hints have been seen before
+bool sink_insert(RemovalSink* sink, const FieldSubset* hints) {
+    // keep the load factor at or below 1/2, a sink that cannot grow accepts duplicates rather than failing
+    if (2 * (sink->emitted + 1) > (uint64_t) sink->seen_mask + 1) {
+        uint32_t grown_mask = 2 * sink->seen_mask + 1;
+        FieldSubset* grown = calloc((size_t) grown_mask + 1, sizeof(FieldSubset));
+        if (!grown)
+            return true;
+        for (uint32_t i = 0; i <= sink->seen_mask; ++i) {
+            if (is_empty_slot(sink->seen + i))
+                continue;
+            uint32_t slot = hash_hints(sink->seen + i) & grown_mask;
+            while (!is_empty_slot(grown + slot)) {
+                slot = (slot + 1) & grown_mask;
+            }
+            grown[slot] = sink->seen[i];
+        }
+        free(sink->seen);
+        sink->seen = grown;
+        sink->seen_mask = grown_mask;
+    }
+    uint32_t slot = hash_hints(hints) & sink->seen_mask;
+    while (!is_empty_slot(sink->seen + slot)) {
+        if (memcmp(sink->seen + slot, hints, sizeof(FieldSubset)) == 0)
+            return false;
+        slot = (slot + 1) & sink->seen_mask;
+    }
+    sink->seen[slot] = *hints;
+    return true;
+}
+
+
+void materialize(RemovalSearch* search) {
+    if (search->materialized)
+        return;
+    hint_state_materialize(&search->hints, &search->solution, &search->sudoku);
+    search->materialized = true;
+}
+
+
+// returns true if the search has to diverge from the emitted instance
+bool emit(RemovalSink* sink, RemovalSearch* search) {
+    if (search->hints.hint_count > sink->max_hints)
+        return false;
+    if (!sink_insert(sink, &search->hints.hints))
+        return false;
+    ++sink->emitted;
+    materialize(search);
+    sink->callback(&search->sudoku, sink->state);
+    return sink->diverge_levels > 0;
+}
+
+
+// undo the last levels - 1 removals without trying the fields after them, the last one is undone by backtracking
+void diverge(RemovalSearch* search, uint32_t levels) {
+    for (uint32_t i = 1; i < levels && search->depth > 0; ++i) {
+        RemovalFrame* frame = search->frames + --search->depth;
+        hint_state_restore_orbit(&search->hints, search->symmetry, frame->field);
+        search->materialized = false;
+    }
+    search->backtracking = true;
+}
+
+
+void init_search(RemovalSearch* search, const Sudoku* solution, Symmetry symmetry, Rng* rng) {
+    memset(search, 0, sizeof(RemovalSearch));
+    search->symmetry = symmetry;
+    search->solution = *solution;
+    hint_state_init_full(&search->hints);
+    search->best = search->hints;
+    search->sudoku = *solution;
+    search->materialized = true;
+
+    // generate a random traversal order in the beginning and move left-to-right only!
+    // this is sufficient because (remove field 1 then 2) == (remove field 2 then 1)
+    ofs_set_orbits(&search->order, symmetry);
+    rng_shuffle(rng, search->order.indices, search->order.size);
+
+    // every hint of a solved instance is implied by its neighbors
+    fs_exclude_all_fields(&search->removable);
+    fs_add_from_ifs(&search->removable, &search->order);
+}
+
+
+void removal_search_init_exhaustive(RemovalSearch* search, const Sudoku* solution, Symmetry symmetry, uint32_t target_hints, Rng* rng) {
+    init_search(search, solution, symmetry, rng);
+    search->mode = REMOVAL_EXHAUSTIVE;
+    search->target_hints = target_hints;
+}
+
+
+void removal_search_init_time_bounded(RemovalSearch* search, const Sudoku* solution, Symmetry symmetry, Rng* rng) {
+    init_search(search, solution, symmetry, rng);
+    search->mode = REMOVAL_TIME_BOUNDED;
+}
+
+
+// branch and bound, decided before any removability check
+// at most the removable hints at or after index_index can still be cleared in the subtree of the current node
+// removability only shrinks with depth, so this bounds the blank fields of every instance in the subtree
+bool subtree_may_improve(const RemovalSearch* search, uint32_t removable_count, const RemovalSink* sink) {
+    uint32_t bound = 81 - search->hints.hint_count + ofs_count_orbit_fields(&search->order, search->index_index, removable_count, search->symmetry);
+    bound = min(bound, 81 - MIN_UNIQUE_HINTS);
+    // the subtree may still hold instances for the sink
+    if (sink && 81 - bound <= sink->max_hints)
+        return true;
+    if (search->mode == REMOVAL_EXHAUSTIVE)
+        return 81 - bound <= search->target_hints;
+    return 81 - bound < search->best.hint_count;
+}
+
+
+// only expand hints that are removable, i.e. the instance stays uniquely solvable
+// a hint that is not removable stays that way if more hints are cleared, so it is pruned from the whole subtree
+RemovalStatus run_removal_search(RemovalSearch* search, SearchBudget* budget, OrderHeuristic heuristic, void* state, RemovalSink* sink) {
+    while (true) {
+        if (search->backtracking) {
+            if (search->depth == 0)
+                return REMOVAL_EXHAUSTED;
+            // reinsert the value and continue with the next field, this effectively loops over all fields
+            RemovalFrame* frame = search->frames + --search->depth;
+            hint_state_restore_orbit(&search->hints, search->symmetry, frame->field);
+            search->materialized = false;
+            search->index_index = frame->index_index + 1;
+            search->removable = frame->removable;
+            search->backtracking = false;
+        }
+        if (search->mode == REMOVAL_TIME_BOUNDED && search->hints.hint_count < search->best.hint_count) {
+            search->best = search->hints;
+        }
+        if (search->mode == REMOVAL_EXHAUSTIVE && search->hints.hint_count <= search->target_hints)
+            return REMOVAL_FOUND;
+        // the node is visited again when the search is continued
+        if (!budget_spend_node(budget))
+            return REMOVAL_SUSPENDED;
+        ++search->nodes;
+
+        if (sink && emit(sink, search)) {
+            diverge(search, sink->diverge_levels);
+            continue;
+        }
+
+        if (search->index_index >= search->order.size) {
+            search->backtracking = true;
+            continue;
+        }
+        uint32_t removable_count = ofs_partition(&search->order, search->index_index, &search->removable);
+        if (removable_count == 0 || !subtree_may_improve(search, removable_count, sink)) {
+            search->backtracking = true;
+            continue;
+        }
+
+        materialize(search);
+        TRACE_BEGIN(heuristic_span);
+        heuristic(&search->order, search->index_index, removable_count, &search->sudoku, 1, state);
+        TRACE_END(heuristic_span, "heuristic");
+
+        RemovalFrame* frame = search->frames + search->depth++;
+        frame->index_index = search->index_index;
+        frame->field = search->order.indices[search->index_index];
+        fs_reset_field(&search->removable, frame->field);
+        frame->removable = search->removable;
+
+        // remove the field and advance, the puzzle is known to have a unique solution
+        hint_state_clear_orbit(&search->hints, search->symmetry, frame->field);
+        sudoku_clear_orbit(&search->sudoku, search->symmetry, frame->field);
+        budget_spend_checks(budget, fs_size(&search->removable));
+        search->removable = find_removable_orbits(&search->sudoku, &search->solution, &search->removable, search->symmetry);
+        ++search->index_index;
+    }
+}
+
+
+RemovalStatus removal_search_run(RemovalSearch* search, SearchBudget* budget, OrderHeuristic heuristic, void* state, RemovalSink* sink) {
+    TRACE_BEGIN(span);
+    RemovalStatus status = run_removal_search(search, budget, heuristic, state, sink);
+    TRACE_END(span, "removal_search");
+    return status;
+}
+
+
+Sudoku removal_search_result(const RemovalSearch* search) {
+    Sudoku result;
+    hint_state_materialize(search->mode == REMOVAL_TIME_BOUNDED ? &search->best : &search->hints, &search->solution, &result);
+    return result;
+}
+
+
+// checkpoints use little-endian fixed-width integers so that they can be resumed on other machines
+bool write_u32(FILE* file, uint32_t value) {
+    uint8_t bytes[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+    return fwrite(bytes, 1, 4, file) == 4;
+}
+
+
+bool write_u64(FILE* file, uint64_t value) {
+    return write_u32(file, (uint32_t) value) && write_u32(file, (uint32_t) (value >> 32u));
+}
+
+
+bool read_u32(FILE* file, uint32_t* value) {
+    uint8_t bytes[4];
+    if (fread(bytes, 1, 4, file) != 4)
+        return false;
+    *value = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        *value |= (uint32_t) bytes[i] << (8 * i);
+    }
+    return true;
+}
+
+
+bool read_u64(FILE* file, uint64_t* value) {
+    uint32_t low, high;
+    if (!read_u32(file, &low) || !read_u32(file, &high))
+        return false;
+    *value = (uint64_t) high << 32u | low;
+    return true;
+}
+
+
+bool write_sudoku(FILE* file, const Sudoku* sudoku) {
+    bool success = write_u32(file, sudoku->blank_fields);
+    for (uint32_t i = 0; i < 81u && success; ++i) {
+        success = write_u32(file, sudoku->data[i]);
+    }
+    return success;
+}
+
+
+bool read_sudoku(FILE* file, Sudoku* sudoku) {
+    bool success = read_u32(file, &sudoku->blank_fields) && sudoku->blank_fields <= 81u;
+    for (uint32_t i = 0; i < 81u && success; ++i) {
+        success = read_u32(file, sudoku->data + i);
+    }
+    return success;
+}
+
+
+bool write_field_subset(FILE* file, const FieldSubset* fields) {
+    return write_u32(file, fields->bits[0]) && write_u32(file, fields->bits[1]) && write_u32(file, fields->bits[2]);
+}
+
+
+bool read_field_subset(FILE* file, FieldSubset* fields) {
+    return read_u32(file, fields->bits) && read_u32(file, fields->bits + 1) && read_u32(file, fields->bits + 2);
+}
+
+
+bool write_hint_state(FILE* file, const HintState* state) {
+    return write_field_subset(file, &state->hints);
+}
+
+
+// the hint count is not stored but recounted, which also rejects bits beyond the grid
+bool read_hint_state(FILE* file, HintState* state) {
+    if (!read_field_subset(file, &state->hints) || state->hints.bits[2] >> 17u)
+        return false;
+    state->hint_count = fs_size(&state->hints);
+    return true;
+}
+
+
+bool removal_search_save(const RemovalSearch* search, const char* path) {
+    char temporary[4096];
+    if (snprintf(temporary, sizeof(temporary), "%s.tmp", path) >= (int) sizeof(temporary))
+        return false;
+    FILE* file = fopen(temporary, "wb");
+    if (!file)
+        return false;
+
+    bool success = fwrite(CHECKPOINT_MAGIC, 1, sizeof(CHECKPOINT_MAGIC), file) == sizeof(CHECKPOINT_MAGIC)
+            && write_u32(file, search->mode)
+            && write_u32(file, search->symmetry)
+            && write_u32(file, search->target_hints)
+            && write_u64(file, search->nodes)
+            && write_sudoku(file, &search->solution)
+            && write_hint_state(file, &search->hints)
+            && write_hint_state(file, &search->best)
+            && write_u32(file, search->order.size);
+    for (uint32_t i = 0; i < 81u && success; ++i) {
+        success = write_u32(file, search->order.indices[i]);
+    }
+    success = success
+            && write_u32(file, search->index_index)
+            && write_field_subset(file, &search->removable)
+            && write_u32(file, search->backtracking)
+            && write_u32(file, search->depth);
+    for (uint32_t i = 0; i < search->depth && success; ++i) {
+        const RemovalFrame* frame = search->frames + i;
+        success = write_u32(file, frame->index_index)
+                && write_u32(file, frame->field)
+                && write_field_subset(file, &frame->removable);
+    }
+    success &= fclose(file) == 0;
+    if (!success) {
+        remove(temporary);
+        return false;
+    }
+#ifdef _WIN32
+    remove(path);
+#endif
+    return rename(temporary, path) == 0;
+}
+
+
+bool removal_search_load(RemovalSearch* search, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    RemovalSearch loaded;
+    memset(&loaded, 0, sizeof(RemovalSearch));
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    uint32_t mode, symmetry, backtracking;
+    bool success = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+            && memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0
+            && read_u32(file, &mode) && mode <= REMOVAL_TIME_BOUNDED
+            && read_u32(file, &symmetry) && symmetry <= SYMMETRY_MIRROR_DIAGONAL
+            && read_u32(file, &loaded.target_hints)
+            && read_u64(file, &loaded.nodes)
+            && read_sudoku(file, &loaded.solution)
+            && read_hint_state(file, &loaded.hints)
+            && read_hint_state(file, &loaded.best)
+            && read_u32(file, &loaded.order.size) && loaded.order.size <= 81u;
+    for (uint32_t i = 0; i < 81u && success; ++i) {
+        success = read_u32(file, loaded.order.indices + i) && loaded.order.indices[i] < 81u;
+    }
+    success = success
+            && read_u32(file, &loaded.index_index) && loaded.index_index <= 81u
+            && read_field_subset(file, &loaded.removable)
+            && read_u32(file, &backtracking)
+            && read_u32(file, &loaded.depth) && loaded.depth <= 81u;
+    for (uint32_t i = 0; i < loaded.depth && success; ++i) {
+        RemovalFrame* frame = loaded.frames + i;
+        success = read_u32(file, &frame->index_index) && frame->index_index < 81u
+                && read_u32(file, &frame->field) && frame->field < 81u
+                && read_field_subset(file, &frame->removable);
+    }
+    fclose(file);
+    if (!success)
+        return false;
+
+    loaded.mode = (RemovalMode) mode;
+    loaded.symmetry = (Symmetry) symmetry;
+    loaded.backtracking = backtracking != 0;
+    *search = loaded;
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef REMOVAL_SEARCH_H
+#define REMOVAL_SEARCH_H
+
+#include "sudoku.h"
+#include "field_subset.h"
+#include "heuristics.h"
+#include "budget.h"
+#include "symmetry.h"
+#include "hint_state.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// depth-first search over hint removals, using an explicit stack instead of recursion
+// the search runs in slices limited by a budget, between two slices it can be saved to a checkpoint file
+// and resumed later, possibly by another process, with exactly the same continuation
+// every node clears one removable hint, then either descends or tries the next hint in the traversal order
+// with a symmetry, a node clears a whole orbit of hints and the traversal order holds orbit representatives
+// the path is carried as the hints kept of the solution, see hint_state.h, so that backtracking and keeping the best
+// instance only copy bits, and the instance with candidates is only rebuilt for the next removability checks
+
+typedef enum {
+    // return once an instance with at most target_hints hints is found
+    REMOVAL_EXHAUSTIVE,
+    // keep the instance with the fewest hints found until the budget is used up, usually a deadline
+    REMOVAL_TIME_BOUNDED
+} RemovalMode;
+
+typedef enum {
+    // the budget is used up, the search may be continued with a new one
+    REMOVAL_SUSPENDED,
+    REMOVAL_FOUND,
+    REMOVAL_EXHAUSTED
+} RemovalStatus;
+
+// one cleared hint on the current path
+typedef struct {
+    uint32_t index_index;
+    // the representative if the search is symmetric, the values are restored from the solution
+    uint32_t field;
+    // removable hints once the field was tried, used to continue with the next field after backtracking
+    FieldSubset removable;
+} RemovalFrame;
+
+// exposed so that searches can live on the stack, use the functions below to access it
+typedef struct {
+    RemovalMode mode;
+    Symmetry symmetry;
+    uint32_t target_hints;
+    uint64_t nodes;
+
+    Sudoku solution;
+    HintState hints;
+    HintState best;
+    // the instance of hints with candidates, for the heuristic and the checks, rebuilt after backtracking
+    Sudoku sudoku;
+    bool materialized;
+    // traversal order, reordered in place by the heuristic
+    OrderedFieldSubset order;
+    uint32_t index_index;
+    FieldSubset removable;
+    // set if the current node is a dead end and the last removal has to be undone
+    bool backtracking;
+    uint32_t depth;
+    RemovalFrame frames[81];
+} RemovalSearch;
+
+typedef void (*InstanceCallback)(const Sudoku* instance, void* state);
+
+// receives every instance visited by a search with at most max_hints hints, each instance only once
+// instances are identified by their hints, so a sink must only be shared by searches starting from the same solution
+typedef struct {
+    uint32_t max_hints;
+    // after an emission, undo this many removals before continuing
+    // 0 keeps removing hints below the emitted instance, which yields better but very similar instances
+    uint32_t diverge_levels;
+    InstanceCallback callback;
+    void* state;
+    uint64_t emitted;
+    // open addressing over the hints of emitted instances, empty slots have no bits set
+    FieldSubset* seen;
+    uint32_t seen_mask;
+} RemovalSink;
+
+// returns false if the sink could not be allocated
+bool removal_sink_init(RemovalSink* sink, uint32_t max_hints, uint32_t diverge_levels, InstanceCallback callback, void* state);
+void removal_sink_destroy(RemovalSink* sink);
+
+void removal_search_init_exhaustive(RemovalSearch* search, const Sudoku* solution, Symmetry symmetry, uint32_t target_hints, Rng* rng);
+void removal_search_init_time_bounded(RemovalSearch* search, const Sudoku* solution, Symmetry symmetry, Rng* rng);
+
+// runs until the search is finished or the budget is exhausted, in which case it returns REMOVAL_SUSPENDED
+// the budget, the heuristic, its state and the sink are not part of the search, they have to be passed in for every slice
+// sink may be NULL, its emitted instances are not part of a checkpoint
+RemovalStatus removal_search_run(RemovalSearch* search, SearchBudget* budget, OrderHeuristic heuristic, void* state, RemovalSink* sink);
+
+// the instance found by an exhaustive search (the solution if there is none), the best one of a time-bounded search
+Sudoku removal_search_result(const RemovalSearch* search);
+
+// checkpoints are written to a temporary file first and then renamed, so an interrupted save keeps the previous one
+bool removal_search_save(const RemovalSearch* search, const char* path);
+// returns false if the file is missing or not a valid checkpoint
+bool removal_search_load(RemovalSearch* search, const char* path);
+
+#endif
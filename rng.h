@@ -0,0 +1,44 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// explicit random number generator state, so that independent generators do not share global rand() state
+// xorshift64* is plenty for shuffling fields and picking candidates
+typedef struct {
+    uint64_t state;
+} Rng;
+
+static inline void rng_seed(Rng *rng, uint64_t seed) {
+    // splitmix64 scrambles the seed so that consecutive seeds yield unrelated sequences
+    uint64_t z = seed + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+    z ^= z >> 31u;
+    // the state must never be zero
+    rng->state = z ? z : 0x9e3779b97f4a7c15ull;
+}
+
+static inline uint32_t rng_next(Rng *rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12u;
+    x ^= x << 25u;
+    x ^= x >> 27u;
+    rng->state = x;
+    return (uint32_t) ((x * 0x2545f4914f6cdd1dull) >> 32u);
+}
+
+static inline uint32_t rng_range(Rng *rng, uint32_t inclusive_start, uint32_t exclusive_end) {
+    return rng_next(rng) % (exclusive_end - inclusive_start) + inclusive_start;
+}
+
+static inline void rng_shuffle(Rng *rng, uint32_t *buffer, uint32_t length) {
+    for (uint32_t i = 0; i < length - 1; ++i) {
+        uint32_t j = rng_range(rng, i, length);
+        uint32_t temp = buffer[i];
+        buffer[i] = buffer[j];
+        buffer[j] = temp;
+    }
+}
+
+#endif
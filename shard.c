@@ -0,0 +1,248 @@
+#include "shard.h"
+#include "sudokugen.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char chars[SUDOKUGEN_CHARS_PER_INSTANCE];
+} MergeRecord;
+
+
+bool shard_parse(const char* text, ShardSpec* shard) {
+    char* end;
+    unsigned long long index = strtoull(text, &end, 10);
+    if (end == text || *end != '/')
+        return false;
+    const char* count_text = end + 1;
+    unsigned long long count = strtoull(count_text, &end, 10);
+    if (end == count_text || *end != '\0' || count == 0 || count > UINT32_MAX || index >= count)
+        return false;
+    shard->index = (uint32_t) index;
+    shard->count = (uint32_t) count;
+    return true;
+}
+
+
+void shard_range(const ShardSpec* shard, uint64_t total, uint64_t* begin, uint64_t* end) {
+    // the first total % count shards get one instance more
+    uint64_t size = total / shard->count, extra = total % shard->count;
+    *begin = shard->index * size + (shard->index < extra ? shard->index : extra);
+    *end = *begin + size + (shard->index < extra);
+}
+
+
+uint64_t shard_instance_seed(uint64_t base_seed, uint64_t instance) {
+    // splitmix64 of the base seed, so that jobs with nearby base seeds do not share the seeds of their instances
+    uint64_t z = base_seed + 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27u)) * 0x94d049bb133111ebull;
+    return (z ^ (z >> 31u)) ^ instance;
+}
+
+
+int compare_records(const void* lhs, const void* rhs) {
+    return memcmp(lhs, rhs, sizeof(MergeRecord));
+}
+
+
+// reads the next line of at least 81 characters and keeps its first 81, shorter lines are skipped
+bool read_instance(FILE* in, MergeRecord* record) {
+    char line[128];
+    while (fgets(line, sizeof(line), in)) {
+        size_t length = strlen(line);
+        // the rest of an overlong line
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n') {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n');
+        }
+        if (length >= SUDOKUGEN_CHARS_PER_INSTANCE) {
+            memcpy(record->chars, line, SUDOKUGEN_CHARS_PER_INSTANCE);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool write_record(FILE* out, const MergeRecord* record, bool lines) {
+    if (fwrite(record->chars, 1, sizeof(record->chars), out) != sizeof(record->chars))
+        return false;
+    return !lines || fputc('\n', out) != EOF;
+}
+
+
+// sorts the chunk and removes its duplicates, returns the number of distinct records left
+uint32_t sort_chunk(MergeRecord* chunk, uint32_t count) {
+    qsort(chunk, count, sizeof(MergeRecord), compare_records);
+    uint32_t distinct = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (distinct == 0 || memcmp(chunk + i, chunk + distinct - 1, sizeof(MergeRecord)) != 0) {
+            chunk[distinct++] = chunk[i];
+        }
+    }
+    return distinct;
+}
+
+
+// writes the sorted chunk to a new temporary file, positioned at its start
+FILE* spill_run(const MergeRecord* chunk, uint32_t count) {
+    FILE* run = tmpfile();
+    if (!run)
+        return NULL;
+    if (fwrite(chunk, sizeof(MergeRecord), count, run) != count || fflush(run) != 0) {
+        fclose(run);
+        return NULL;
+    }
+    rewind(run);
+    return run;
+}
+
+
+void sift_down(uint32_t* heap, uint32_t size, const MergeRecord* heads, uint32_t position) {
+    while (true) {
+        uint32_t smallest = position, left = 2 * position + 1, right = left + 1;
+        if (left < size && compare_records(heads + heap[left], heads + heap[smallest]) < 0)
+            smallest = left;
+        if (right < size && compare_records(heads + heap[right], heads + heap[smallest]) < 0)
+            smallest = right;
+        if (smallest == position)
+            return;
+        uint32_t temp = heap[position];
+        heap[position] = heap[smallest];
+        heap[smallest] = temp;
+        position = smallest;
+    }
+}
+
+
+// k-way merge of at most SHARD_MERGE_FAN_IN sorted runs, duplicates across runs are written once
+// lines selects newline-terminated output over raw records, the runs are closed
+bool merge_runs(FILE** runs, uint32_t count, FILE* out, bool lines, uint64_t* written) {
+    MergeRecord heads[SHARD_MERGE_FAN_IN];
+    uint32_t heap[SHARD_MERGE_FAN_IN];
+    uint32_t size = 0;
+    for (uint32_t r = 0; r < count; ++r) {
+        if (fread(heads + r, sizeof(MergeRecord), 1, runs[r]) == 1)
+            heap[size++] = r;
+    }
+    for (uint32_t i = size; i-- > 0;) {
+        sift_down(heap, size, heads, i);
+    }
+
+    bool success = true;
+    MergeRecord last;
+    bool any = false;
+    while (size > 0 && success) {
+        uint32_t r = heap[0];
+        if (!any || compare_records(heads + r, &last) != 0) {
+            success = write_record(out, heads + r, lines);
+            last = heads[r];
+            any = true;
+            ++*written;
+        }
+        if (fread(heads + r, sizeof(MergeRecord), 1, runs[r]) != 1)
+            heap[0] = heap[--size];
+        sift_down(heap, size, heads, 0);
+    }
+
+    for (uint32_t r = 0; r < count; ++r) {
+        success &= !ferror(runs[r]);
+        fclose(runs[r]);
+    }
+    return success;
+}
+
+
+typedef struct {
+    FILE** files;
+    uint32_t count;
+    uint32_t capacity;
+} RunList;
+
+
+// closes the run if it cannot be added
+bool push_run(RunList* runs, FILE* run) {
+    if (!run)
+        return false;
+    if (runs->count == runs->capacity) {
+        uint32_t capacity = runs->capacity ? 2 * runs->capacity : SHARD_MERGE_FAN_IN;
+        FILE** grown = realloc(runs->files, capacity * sizeof(FILE*));
+        if (!grown) {
+            fclose(run);
+            return false;
+        }
+        runs->files = grown;
+        runs->capacity = capacity;
+    }
+    runs->files[runs->count++] = run;
+    return true;
+}
+
+
+bool shard_merge(FILE** inputs, uint32_t input_count, FILE* out, ShardMergeStats* stats) {
+    ShardMergeStats local = {0, 0, 0};
+    MergeRecord* chunk = malloc(SHARD_MERGE_CHUNK * sizeof(MergeRecord));
+    if (!chunk)
+        return false;
+    RunList runs = {NULL, 0, 0};
+    bool success = true;
+
+    // first pass: sorted runs of one chunk each
+    uint32_t filled = 0;
+    for (uint32_t i = 0; i < input_count && success; ++i) {
+        while (success && read_instance(inputs[i], chunk + filled)) {
+            ++local.read;
+            if (++filled == SHARD_MERGE_CHUNK) {
+                success = push_run(&runs, spill_run(chunk, sort_chunk(chunk, filled)));
+                filled = 0;
+            }
+        }
+        success &= !ferror(inputs[i]);
+    }
+
+    // everything fit into memory
+    if (success && runs.count == 0) {
+        uint32_t distinct = sort_chunk(chunk, filled);
+        for (uint32_t i = 0; i < distinct && success; ++i) {
+            success = write_record(out, chunk + i, true);
+        }
+        local.written = distinct;
+    }
+    if (success && runs.count > 0 && filled > 0)
+        success = push_run(&runs, spill_run(chunk, sort_chunk(chunk, filled)));
+    free(chunk);
+    local.runs = runs.count;
+
+    // merges the oldest runs into a new one at the end until a single merge is left
+    // so that at most SHARD_MERGE_FAN_IN files are read at once and every record is rewritten only logarithmically often
+    uint32_t first = 0;
+    while (success && runs.count - first > SHARD_MERGE_FAN_IN) {
+        FILE* merged = tmpfile();
+        if (!merged) {
+            success = false;
+            break;
+        }
+        uint64_t ignored = 0;
+        success = merge_runs(runs.files + first, SHARD_MERGE_FAN_IN, merged, false, &ignored) && fflush(merged) == 0;
+        first += SHARD_MERGE_FAN_IN;
+        if (success) {
+            rewind(merged);
+            success = push_run(&runs, merged);
+        } else {
+            fclose(merged);
+        }
+    }
+    if (success && runs.count > first) {
+        success = merge_runs(runs.files + first, runs.count - first, out, true, &local.written);
+        first = runs.count;
+    }
+    for (uint32_t r = first; r < runs.count; ++r) {
+        fclose(runs.files[r]);
+    }
+
+    free(runs.files);
+    if (stats)
+        *stats = local;
+    return success && fflush(out) == 0;
+}
@@ -0,0 +1,43 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// large jobs split across processes and machines without coordination
+// a job of total instances with a base seed is numbered 0 to total - 1, instance j is generated from a seed derived from
+// the base seed and j alone, and shard i of n generates the j in its contiguous range
+// so the shards are disjoint, and with node or check budgets instead of a deadline every instance is reproducible,
+// independently of the number of shards
+// shard outputs are combined by shard_merge, an external merge sort that removes duplicates in bounded memory
+
+typedef struct {
+    uint32_t index;
+    uint32_t count;
+} ShardSpec;
+
+// parses "i/n" with i < n
+bool shard_parse(const char* text, ShardSpec* shard);
+// [begin, end) of the instance numbers of the shard
+void shard_range(const ShardSpec* shard, uint64_t total, uint64_t* begin, uint64_t* end);
+uint64_t shard_instance_seed(uint64_t base_seed, uint64_t instance);
+
+// instances sorted into memory at once, 81 bytes each, and the most runs merged at once
+#define SHARD_MERGE_CHUNK 262144u
+#define SHARD_MERGE_FAN_IN 64u
+
+typedef struct {
+    // lines of at least 81 characters, only their first 81 characters count
+    uint64_t read;
+    uint64_t written;
+    // sorted runs spilled to temporary files, 0 if everything fit into one chunk
+    uint32_t runs;
+} ShardMergeStats;
+
+// writes the distinct instances of all inputs to out in lexicographic order, one per line
+// the inputs do not need to be sorted, chunks of them are sorted into temporary files which are then merged k-way
+// stats may be NULL, returns false on read or write errors
+bool shard_merge(FILE** inputs, uint32_t input_count, FILE* out, ShardMergeStats* stats);
+
+#endif
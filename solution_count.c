@@ -0,0 +1,197 @@
+#include "solution_count.h"
+#include "utils.h"
+
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+typedef struct {
+    uint64_t cap;
+    uint64_t solutions;
+    int stopped;
+    int interrupted;
+    // deadline and cancel flag of the count, every task spends its nodes on a copy
+    SearchBudget budget;
+} Counter;
+
+
+// empty field with the fewest candidates, 81 if the grid is filled
+uint32_t branch_field(const Sudoku* sudoku) {
+    uint32_t field = 81, min = 10;
+    for (uint32_t i = 0; i < 81u && min > 2; ++i) {
+        if (sudoku->data[i] & LOWER)
+            continue;
+        uint32_t count = population_count(sudoku->data[i] >> SHIFT);
+        if (count < min) {
+            min = count;
+            field = i;
+        }
+    }
+    return field;
+}
+
+
+bool is_stopped(Counter* counter) {
+    int stopped;
+#pragma omp atomic read
+    stopped = counter->stopped;
+    return stopped != 0;
+}
+
+
+void add_solution(Counter* counter) {
+    uint64_t solutions;
+#pragma omp atomic capture
+    solutions = ++counter->solutions;
+    if (counter->cap && solutions >= counter->cap) {
+#pragma omp atomic write
+        counter->stopped = 1;
+    }
+}
+
+
+// stops all tasks once the deadline has passed or the count was cancelled
+bool spend_node(Counter* counter, SearchBudget* budget) {
+    if (budget_spend_node(budget))
+        return true;
+#pragma omp atomic write
+    counter->interrupted = 1;
+#pragma omp atomic write
+    counter->stopped = 1;
+    return false;
+}
+
+
+// the instance is consumed
+void count_subtree(Sudoku* sudoku, Counter* counter, SearchBudget* budget) {
+    if (is_stopped(counter) || !spend_node(counter, budget) || !sudoku_propagate(sudoku))
+        return;
+    uint32_t field = branch_field(sudoku);
+    if (field == 81) {
+        add_solution(counter);
+        return;
+    }
+    uint32_t candidates = sudoku->data[field] >> SHIFT;
+    while (candidates) {
+        uint32_t candidate = candidates & -candidates;
+        candidates &= ~candidate;
+        Sudoku child = *sudoku;
+        sudoku_put_one_hot_value(&child, field, candidate);
+        count_subtree(&child, counter, budget);
+    }
+}
+
+
+CountConfig count_default_config() {
+    CountConfig config;
+    config.cap = 0;
+    config.threads = 0;
+    config.tasks_per_thread = 16;
+    config.progress = NULL;
+    config.progress_state = NULL;
+    config.max_seconds = 0.0;
+    config.cancel = NULL;
+    return config;
+}
+
+
+// replaces every node of the frontier by its children, solutions and contradictions are dropped
+// returns false if the next frontier could not be allocated
+bool expand_frontier(Sudoku** frontier, uint32_t* size, Counter* counter) {
+    Sudoku* next = malloc((size_t) *size * 9 * sizeof(Sudoku));
+    if (!next)
+        return false;
+    uint32_t next_size = 0;
+    for (uint32_t n = 0; n < *size; ++n) {
+        Sudoku* node = *frontier + n;
+        uint32_t field = branch_field(node);
+        uint32_t candidates = node->data[field] >> SHIFT;
+        while (candidates) {
+            uint32_t candidate = candidates & -candidates;
+            candidates &= ~candidate;
+            Sudoku* child = next + next_size;
+            *child = *node;
+            sudoku_put_one_hot_value(child, field, candidate);
+            if (!sudoku_propagate(child))
+                continue;
+            if (branch_field(child) == 81) {
+                add_solution(counter);
+                continue;
+            }
+            ++next_size;
+        }
+    }
+    free(*frontier);
+    *frontier = next;
+    *size = next_size;
+    return true;
+}
+
+
+CountResult sudoku_count_solutions(const Sudoku* sudoku, const CountConfig* config) {
+    CountResult result = {0, false, false, 0};
+    Counter counter = {.cap = config->cap, .solutions = 0, .stopped = 0, .interrupted = 0};
+    budget_init(&counter.budget);
+    // nodes of the counter are much cheaper than removal steps
+    counter.budget.clock_interval = 1024;
+    counter.budget.cancel = config->cancel;
+    if (config->max_seconds > 0.0)
+        budget_set_seconds(&counter.budget, config->max_seconds);
+
+    uint32_t threads = config->threads;
+#ifdef _OPENMP
+    if (threads == 0)
+        threads = (uint32_t) omp_get_max_threads();
+#else
+    threads = 1;
+#endif
+    uint32_t target_tasks = threads * (config->tasks_per_thread ? config->tasks_per_thread : 1);
+
+    Sudoku* frontier = malloc(sizeof(Sudoku));
+    if (!frontier) {
+        result.tasks = UINT32_MAX;
+        return result;
+    }
+    *frontier = *sudoku;
+    uint32_t size = 1;
+    if (!hints_consistent(frontier) || !sudoku_propagate(frontier)) {
+        size = 0;
+    } else if (branch_field(frontier) == 81) {
+        add_solution(&counter);
+        size = 0;
+    }
+
+    // a single thread still splits, which makes the progress reports more fine-grained
+    while (size > 0 && size < target_tasks && !is_stopped(&counter) && spend_node(&counter, &counter.budget)) {
+        if (!expand_frontier(&frontier, &size, &counter)) {
+            free(frontier);
+            result.tasks = UINT32_MAX;
+            return result;
+        }
+    }
+
+    uint32_t tasks_done = 0;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+    for (int32_t task = 0; task < (int32_t) size; ++task) {
+        SearchBudget budget = counter.budget;
+        count_subtree(frontier + task, &counter, &budget);
+        if (config->progress) {
+#pragma omp critical(count_progress)
+            {
+                uint64_t solutions;
+#pragma omp atomic read
+                solutions = counter.solutions;
+                config->progress(solutions, ++tasks_done, size, config->progress_state);
+            }
+        }
+    }
+    free(frontier);
+
+    result.capped = counter.cap && counter.solutions >= counter.cap;
+    result.interrupted = counter.interrupted && !result.capped;
+    result.solutions = result.capped ? counter.cap : counter.solutions;
+    result.tasks = size;
+    return result;
+}
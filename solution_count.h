@@ -0,0 +1,52 @@
+#ifndef SOLUTION_COUNT_H
+#define SOLUTION_COUNT_H
+
+#include "sudoku.h"
+#include "budget.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// exact number of solutions of an instance, e.g. to calibrate how far an instance is from being unique
+// the top levels of the search tree are expanded breadth-first into independent subtrees (tasks)
+// which are counted in parallel with OpenMP, without OpenMP they are counted one after another
+
+// called whenever a task is finished, from one thread at a time
+typedef void (*CountProgress)(uint64_t solutions, uint32_t tasks_done, uint32_t tasks_total, void* state);
+
+typedef struct {
+    // stop once this many solutions are found, 0 counts all of them
+    uint64_t cap;
+    // 0 uses all cores
+    uint32_t threads;
+    // the top levels are expanded until there are this many tasks per thread, more tasks balance the load better
+    uint32_t tasks_per_thread;
+    // NULL disables progress reports
+    CountProgress progress;
+    void* progress_state;
+    // wall-clock limit of the whole count, 0 for none
+    double max_seconds;
+    // other threads may set the flag to end the count, NULL if not cancellable
+    CancelFlag* cancel;
+} CountConfig;
+
+typedef struct {
+    // at most cap if a cap is set
+    uint64_t solutions;
+    // set if the count stopped at the cap, the actual number may be higher
+    bool capped;
+    // set if the count ran out of time or was cancelled, the solutions found so far are a lower bound
+    bool interrupted;
+    uint32_t tasks;
+} CountResult;
+
+CountConfig count_default_config();
+
+// empty field with the fewest candidates, 81 if the grid is filled
+uint32_t branch_field(const Sudoku* sudoku);
+
+// instances with contradicting hints have no solution
+// returns a zero count with tasks set to UINT32_MAX if the tasks could not be allocated
+CountResult sudoku_count_solutions(const Sudoku* sudoku, const CountConfig* config);
+
+#endif
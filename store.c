@@ -0,0 +1,376 @@
+#include "store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STORE_MMAP
+#else
+#include <io.h>
+#endif
+
+static const char DATA_MAGIC[8] = "SDKDAT1";
+static const char INDEX_MAGIC[8] = "SDKIDX1";
+
+typedef struct {
+    char magic[8];
+    // number of data records covered by this index
+    uint64_t record_count;
+    // records of bucket b are record_ids[bucket_offsets[b]] up to record_ids[bucket_offsets[b + 1]]
+    uint32_t bucket_offsets[STORE_BUCKETS + 1];
+} StoreIndexHeader;
+
+struct StoreWriter {
+    FILE* data;
+};
+
+struct StoreReader {
+    const char* data;
+    size_t data_length;
+    const char* index;
+    size_t index_length;
+    const StoreIndexHeader* header;
+    const uint32_t* record_ids;
+};
+
+
+uint32_t bucket_of(uint32_t hints, uint32_t difficulty) {
+    return hints * STORE_DIFFICULTY_LEVELS + difficulty;
+}
+
+
+FILE* open_suffixed(const char* path, const char* suffix, const char* mode) {
+    char buffer[4096];
+    if (snprintf(buffer, sizeof(buffer), "%s%s", path, suffix) >= (int) sizeof(buffer))
+        return NULL;
+    return fopen(buffer, mode);
+}
+
+
+// length of the magic and the whole records of a data file, a torn record at the end left by a crashed writer is not counted
+// a file shorter than the magic counts as empty, returns false if the magic does not match
+bool whole_records_length(FILE* data, long* length) {
+    if (fseek(data, 0, SEEK_END) != 0)
+        return false;
+    long size = ftell(data);
+    if (size < 0)
+        return false;
+    if ((size_t) size < sizeof(DATA_MAGIC)) {
+        *length = 0;
+        return true;
+    }
+    char magic[sizeof(DATA_MAGIC)];
+    if (fseek(data, 0, SEEK_SET) != 0 || fread(magic, 1, sizeof(magic), data) != sizeof(magic) || memcmp(magic, DATA_MAGIC, sizeof(magic)) != 0)
+        return false;
+    *length = (long) (sizeof(DATA_MAGIC) + (size - sizeof(DATA_MAGIC)) / sizeof(StoreRecord) * sizeof(StoreRecord));
+    return true;
+}
+
+
+bool truncate_file(FILE* file, long length) {
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), length) == 0;
+#else
+    return ftruncate(fileno(file), length) == 0;
+#endif
+}
+
+
+StoreWriter* store_open_writer(const char* path) {
+    FILE* data = open_suffixed(path, ".dat", "r+b");
+    if (!data)
+        data = open_suffixed(path, ".dat", "w+b");
+    if (!data)
+        return NULL;
+    // appending after a torn record would misalign every record that follows, so the file is cut back to whole records
+    // a fresh data file starts with the magic
+    long length;
+    if (!whole_records_length(data, &length) || !truncate_file(data, length) || fseek(data, 0, SEEK_END) != 0
+            || (length == 0 && fwrite(DATA_MAGIC, 1, sizeof(DATA_MAGIC), data) != sizeof(DATA_MAGIC))) {
+        fclose(data);
+        return NULL;
+    }
+    StoreWriter* writer = malloc(sizeof(StoreWriter));
+    if (!writer) {
+        fclose(data);
+        return NULL;
+    }
+    writer->data = data;
+    return writer;
+}
+
+
+bool store_append(StoreWriter* writer, const char* instances, const uint8_t* difficulties, uint32_t count) {
+    // write in chunks to keep the number of calls low without allocating
+    StoreRecord records[256];
+    for (uint32_t offset = 0; offset < count; offset += 256) {
+        uint32_t chunk = count - offset < 256 ? count - offset : 256;
+        for (uint32_t i = 0; i < chunk; ++i) {
+            StoreRecord* record = records + i;
+            const char* instance = instances + (size_t) (offset + i) * 81;
+            memcpy(record->instance, instance, 81);
+            record->hints = 0;
+            for (uint32_t k = 0; k < 81; ++k) {
+                record->hints += instance[k] != '0';
+            }
+            record->difficulty = difficulties ? difficulties[offset + i] : 0;
+            if (record->difficulty >= STORE_DIFFICULTY_LEVELS)
+                record->difficulty = STORE_DIFFICULTY_LEVELS - 1;
+            record->reserved = 0;
+        }
+        if (fwrite(records, sizeof(StoreRecord), chunk, writer->data) != chunk)
+            return false;
+    }
+    return true;
+}
+
+
+bool store_close_writer(StoreWriter* writer) {
+    bool success = fclose(writer->data) == 0;
+    free(writer);
+    return success;
+}
+
+
+// copies all records of one data file to the end of another, without interpreting them
+bool append_records(FILE* target, const char* source_path) {
+    FILE* source = open_suffixed(source_path, ".dat", "rb");
+    if (!source)
+        return false;
+    // a torn record at the end of the source is left out, it would misalign the records appended after it
+    long length;
+    bool success = whole_records_length(source, &length) && length > 0 && fseek(source, sizeof(DATA_MAGIC), SEEK_SET) == 0;
+    size_t remaining = success ? (size_t) length - sizeof(DATA_MAGIC) : 0;
+    char buffer[sizeof(StoreRecord) * 1024];
+    while (success && remaining > 0) {
+        size_t chunk = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+        success = fread(buffer, 1, chunk, source) == chunk && fwrite(buffer, 1, chunk, target) == chunk;
+        remaining -= chunk;
+    }
+    fclose(source);
+    return success;
+}
+
+
+bool store_merge(const char* target_path, const char** source_paths, uint32_t source_count) {
+    StoreWriter* writer = store_open_writer(target_path);
+    if (!writer)
+        return false;
+    bool success = true;
+    for (uint32_t i = 0; i < source_count && success; ++i) {
+        success = append_records(writer->data, source_paths[i]);
+    }
+    success &= store_close_writer(writer);
+    return success && store_build_index(target_path);
+}
+
+
+bool store_build_index(const char* path) {
+    FILE* data = open_suffixed(path, ".dat", "rb");
+    if (!data)
+        return false;
+
+    StoreIndexHeader* header = calloc(1, sizeof(StoreIndexHeader));
+    char magic[sizeof(DATA_MAGIC)];
+    if (!header || fread(magic, 1, sizeof(magic), data) != sizeof(magic) || memcmp(magic, DATA_MAGIC, sizeof(magic)) != 0) {
+        free(header);
+        fclose(data);
+        return false;
+    }
+    memcpy(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+
+    // first pass: bucket sizes
+    fseek(data, 0, SEEK_END);
+    uint64_t record_count = ((uint64_t) ftell(data) - sizeof(DATA_MAGIC)) / sizeof(StoreRecord);
+    uint16_t* record_buckets = malloc(record_count * sizeof(uint16_t) + 1);
+    uint32_t* record_ids = malloc(record_count * sizeof(uint32_t) + 1);
+    if (!record_buckets || !record_ids) {
+        free(record_buckets);
+        free(record_ids);
+        free(header);
+        fclose(data);
+        return false;
+    }
+    fseek(data, sizeof(DATA_MAGIC), SEEK_SET);
+    StoreRecord record;
+    for (uint64_t i = 0; i < record_count; ++i) {
+        if (fread(&record, sizeof(StoreRecord), 1, data) != 1) {
+            record_count = i;
+            break;
+        }
+        uint32_t hints = record.hints <= 81 ? record.hints : 81;
+        uint32_t difficulty = record.difficulty < STORE_DIFFICULTY_LEVELS ? record.difficulty : 0;
+        record_buckets[i] = (uint16_t) bucket_of(hints, difficulty);
+        ++header->bucket_offsets[record_buckets[i] + 1];
+    }
+    fclose(data);
+
+    // second pass: counting sort of record ids by bucket
+    for (uint32_t b = 0; b < STORE_BUCKETS; ++b) {
+        header->bucket_offsets[b + 1] += header->bucket_offsets[b];
+    }
+    uint32_t fill[STORE_BUCKETS];
+    memcpy(fill, header->bucket_offsets, sizeof(fill));
+    for (uint64_t i = 0; i < record_count; ++i) {
+        record_ids[fill[record_buckets[i]]++] = (uint32_t) i;
+    }
+    header->record_count = record_count;
+
+    // write to a temporary file first so that readers never see a partial index
+    char temporary[4096], final[4096];
+    snprintf(temporary, sizeof(temporary), "%s.idx.tmp", path);
+    snprintf(final, sizeof(final), "%s.idx", path);
+    FILE* index = fopen(temporary, "wb");
+    bool success = index
+            && fwrite(header, sizeof(StoreIndexHeader), 1, index) == 1
+            && fwrite(record_ids, sizeof(uint32_t), record_count, index) == record_count;
+    if (index)
+        success &= fclose(index) == 0;
+    free(record_buckets);
+    free(record_ids);
+    free(header);
+    if (!success)
+        return false;
+#ifdef _WIN32
+    remove(final);
+#endif
+    return rename(temporary, final) == 0;
+}
+
+
+// maps a whole file read-only, falls back to reading it into memory without mmap
+const char* map_file(const char* path, const char* suffix, size_t* length) {
+    char buffer[4096];
+    if (snprintf(buffer, sizeof(buffer), "%s%s", path, suffix) >= (int) sizeof(buffer))
+        return NULL;
+#ifdef STORE_MMAP
+    int fd = open(buffer, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void* mapping = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return NULL;
+    *length = (size_t) info.st_size;
+    return (const char*) mapping;
+#else
+    FILE* file = fopen(buffer, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = size > 0 ? malloc((size_t) size) : NULL;
+    if (!contents || fread(contents, 1, (size_t) size, file) != (size_t) size) {
+        free(contents);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    *length = (size_t) size;
+    return contents;
+#endif
+}
+
+
+void unmap_file(const char* contents, size_t length) {
+    if (!contents)
+        return;
+#ifdef STORE_MMAP
+    munmap((void*) contents, length);
+#else
+    free((void*) contents);
+#endif
+}
+
+
+// bucket offsets must not decrease nor exceed the records, and records must exist, so that fetching stays in bounds
+bool index_valid(const StoreReader* reader) {
+    const StoreIndexHeader* header = reader->header;
+    for (uint32_t b = 0; b < STORE_BUCKETS; ++b) {
+        if (header->bucket_offsets[b] > header->bucket_offsets[b + 1])
+            return false;
+    }
+    if (header->bucket_offsets[STORE_BUCKETS] > header->record_count)
+        return false;
+    for (uint64_t i = 0; i < header->record_count; ++i) {
+        if (reader->record_ids[i] >= header->record_count)
+            return false;
+    }
+    return true;
+}
+
+
+StoreReader* store_open_reader(const char* path) {
+    StoreReader* reader = calloc(1, sizeof(StoreReader));
+    if (!reader)
+        return NULL;
+    reader->data = map_file(path, ".dat", &reader->data_length);
+    reader->index = map_file(path, ".idx", &reader->index_length);
+    if (!reader->data || !reader->index || reader->data_length < sizeof(DATA_MAGIC) || reader->index_length < sizeof(StoreIndexHeader)) {
+        store_close_reader(reader);
+        return NULL;
+    }
+    reader->header = (const StoreIndexHeader*) reader->index;
+    reader->record_ids = (const uint32_t*) (reader->index + sizeof(StoreIndexHeader));
+
+    // reject foreign files and indices referring to more records than available
+    uint64_t available_records = (reader->data_length - sizeof(DATA_MAGIC)) / sizeof(StoreRecord);
+    if (memcmp(reader->data, DATA_MAGIC, sizeof(DATA_MAGIC)) != 0
+            || memcmp(reader->header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+            || reader->header->record_count > available_records
+            || reader->index_length < sizeof(StoreIndexHeader) + reader->header->record_count * sizeof(uint32_t)
+            || !index_valid(reader)) {
+        store_close_reader(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+
+void store_close_reader(StoreReader* reader) {
+    unmap_file(reader->data, reader->data_length);
+    unmap_file(reader->index, reader->index_length);
+    free(reader);
+}
+
+
+uint64_t store_size(const StoreReader* reader) {
+    return reader->header->record_count;
+}
+
+
+uint32_t store_bucket_size(const StoreReader* reader, uint32_t hints, uint32_t difficulty) {
+    if (hints > 81 || difficulty >= STORE_DIFFICULTY_LEVELS)
+        return 0;
+    uint32_t bucket = bucket_of(hints, difficulty);
+    return reader->header->bucket_offsets[bucket + 1] - reader->header->bucket_offsets[bucket];
+}
+
+
+const StoreRecord* store_bucket_record(const StoreReader* reader, uint32_t hints, uint32_t difficulty, uint32_t position) {
+    if (position >= store_bucket_size(reader, hints, difficulty))
+        return NULL;
+    uint32_t record_id = reader->record_ids[reader->header->bucket_offsets[bucket_of(hints, difficulty)] + position];
+    return (const StoreRecord*) (reader->data + sizeof(DATA_MAGIC) + (size_t) record_id * sizeof(StoreRecord));
+}
+
+
+const StoreRecord* store_random_record(const StoreReader* reader, uint32_t hints, uint32_t difficulty, Rng* rng) {
+    uint32_t size = store_bucket_size(reader, hints, difficulty);
+    if (size == 0)
+        return NULL;
+    return store_bucket_record(reader, hints, difficulty, rng_range(rng, 0, size));
+}
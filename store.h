@@ -0,0 +1,50 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include "rng.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// persistent puzzle store consisting of two files
+// <path>.dat: append-only sequence of fixed-size records, one per instance
+// <path>.idx: record numbers grouped into buckets by hint count and difficulty, rebuilt by store_build_index
+// a store is sharded by letting every process append to its own path, shards are merged by concatenating records
+// records appended after the last store_build_index are invisible to readers until the index is rebuilt
+
+// difficulty 0 means that the instance has not been rated
+#define STORE_DIFFICULTY_LEVELS 8u
+#define STORE_BUCKETS (82u * STORE_DIFFICULTY_LEVELS)
+
+typedef struct {
+    char instance[81];
+    uint8_t hints;
+    uint8_t difficulty;
+    uint8_t reserved;
+} StoreRecord;
+
+typedef struct StoreWriter StoreWriter;
+typedef struct StoreReader StoreReader;
+
+// an existing data file is cut back to its whole records, dropping a torn record left by a crashed writer
+// returns NULL if the data file could not be opened or is not a store data file
+StoreWriter* store_open_writer(const char* path);
+// appends count instances of 81 characters each, difficulties may be NULL if the instances are unrated
+bool store_append(StoreWriter* writer, const char* instances, const uint8_t* difficulties, uint32_t count);
+bool store_close_writer(StoreWriter* writer);
+
+// appends all records of the source stores to the target store, then rebuilds the target index
+bool store_merge(const char* target_path, const char** source_paths, uint32_t source_count);
+bool store_build_index(const char* path);
+
+// returns NULL if the store has not been indexed or could not be mapped
+StoreReader* store_open_reader(const char* path);
+void store_close_reader(StoreReader* reader);
+uint64_t store_size(const StoreReader* reader);
+uint32_t store_bucket_size(const StoreReader* reader, uint32_t hints, uint32_t difficulty);
+// returns NULL if position is not below store_bucket_size
+const StoreRecord* store_bucket_record(const StoreReader* reader, uint32_t hints, uint32_t difficulty, uint32_t position);
+// returns NULL if the bucket is empty
+const StoreRecord* store_random_record(const StoreReader* reader, uint32_t hints, uint32_t difficulty, Rng* rng);
+
+#endif
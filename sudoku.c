@@ -1,6 +1,9 @@
 #include "sudoku.h"
 #include "utils.h"
+#include "units.h"
+#include "trace.h"
 
+#include <stddef.h>
 #include <stdio.h>
 
 
@@ -17,6 +20,13 @@ void sudoku_init(Sudoku *sudoku) {
     }
 }
 
+#ifdef SUDOKUGEN_GENERATED_KERNELS
+// the unit walks below come as straight-line code from kernel_generator.c, hidden_singles needs put
+void put(Sudoku *sudoku, uint32_t field, uint32_t candidate);
+#define SUDOKU_KERNELS_PUT
+#include "sudoku_kernels.h"
+#else
+
 typedef struct {
     uint32_t start;
     uint32_t inc;
@@ -40,7 +50,12 @@ static const BlockDefinition block_definitions[27] = {
         {.start = 54, .inc = 1, .skip = 6}, {.start = 57, .inc = 1, .skip = 6}, {.start = 60, .inc = 1, .skip = 6}
 };
 
+#endif
+
 void remove_adjacent(Sudoku *sudoku, uint32_t field, uint32_t candidate) {
+#ifdef SUDOKUGEN_GENERATED_KERNELS
+    kernel_remove_peer_candidates(sudoku->data, field, (~candidate << SHIFT) | LOWER);
+#else
     uint32_t r = field / 9u * 9u, c = field % 9u, sq = field / 27u * 27u + c / 3u * 3u;
     uint32_t mask = (~candidate << SHIFT) | LOWER;
     for (uint32_t i = 0; i < 9; ++i) {
@@ -52,6 +67,7 @@ void remove_adjacent(Sudoku *sudoku, uint32_t field, uint32_t candidate) {
             sudoku->data[sq + 9 * i + j] &= mask;
         }
     }
+#endif
 }
 
 void put(Sudoku *sudoku, uint32_t field, uint32_t candidate) {
@@ -109,8 +125,11 @@ void replace_candidates_if_empty(Sudoku *sudoku, CandidateSummary *cs, uint32_t
 }
 
 void recompute_adjacent(Sudoku *sudoku, uint32_t field) {
+#ifdef SUDOKUGEN_GENERATED_KERNELS
+    kernel_recompute_candidates(sudoku->data, field);
+#else
     CandidateSummary cs = summarize_candidates(sudoku);
-    uint32_t r = field / 9u, c = field % 9u, sqr = r / 3u, sqc = c / 3u;
+    uint32_t r = field / 9u, c = field % 9u, sqr = r / 3u * 3u, sqc = c / 3u * 3u;
     for (uint32_t i = 0; i < 9; ++i) {
         // rows
         replace_candidates_if_empty(sudoku, &cs, i, c);
@@ -123,6 +142,7 @@ void recompute_adjacent(Sudoku *sudoku, uint32_t field) {
             replace_candidates_if_empty(sudoku, &cs, sqr + i, sqc + j);
         }
     }
+#endif
 }
 
 // clear a field and recompute adjacent candidates
@@ -132,6 +152,11 @@ void sudoku_clear_field(Sudoku *sudoku, uint32_t field) {
     recompute_adjacent(sudoku, field);
 }
 
+// forbid a candidate for an empty field, e.g. to search for solutions other than a known one
+void sudoku_exclude_one_hot_candidate(Sudoku *sudoku, uint32_t field, uint32_t candidate) {
+    sudoku->data[field] &= ~(candidate << SHIFT);
+}
+
 bool singles(Sudoku *sudoku) {
     bool found = false;
 
@@ -151,6 +176,7 @@ bool singles(Sudoku *sudoku) {
     return found;
 }
 
+#ifndef SUDOKUGEN_GENERATED_KERNELS
 bool hidden_singles_block(Sudoku *sudoku, const BlockDefinition *block) {
 
     uint32_t once_or_more = 0, twice_or_more = 0;
@@ -183,38 +209,78 @@ bool hidden_singles_block(Sudoku *sudoku, const BlockDefinition *block) {
     return true;
 }
 
+#endif
+
 bool hidden_singles(Sudoku *sudoku) {
+#ifdef SUDOKUGEN_GENERATED_KERNELS
+    return kernel_hidden_singles(sudoku);
+#else
     bool found = false;
     for (uint32_t n = 0; n < 27; ++n) {
         found |= hidden_singles_block(sudoku, block_definitions + n);
     }
     return found;
+#endif
+}
+
+bool hints_consistent(const Sudoku *sudoku) {
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        uint32_t placed = 0;
+        for (uint32_t k = 0; k < 9; ++k) {
+            uint32_t value = sudoku->data[UNIT_FIELDS[unit][k]] & LOWER;
+            if (placed & value)
+                return false;
+            placed |= value;
+        }
+    }
+    return true;
+}
+
+
+// singles and hidden singles do not stop at contradictions, so the grid they leave is checked afterwards
+// a field without candidates or a digit without a place in some unit, and for a filled grid a digit placed twice
+bool sudoku_propagate(Sudoku *sudoku) {
+    while (singles(sudoku) || hidden_singles(sudoku));
+    if (sudoku->blank_fields == 0)
+        return hints_consistent(sudoku);
+    for (uint32_t unit = 0; unit < UNIT_COUNT; ++unit) {
+        uint32_t digits = 0;
+        for (uint32_t k = 0; k < 9; ++k) {
+            uint32_t data = sudoku->data[UNIT_FIELDS[unit][k]];
+            if (!data)
+                return false;
+            digits |= (data & LOWER) | (data >> SHIFT);
+        }
+        if (digits != ALL_CANDIDATES)
+            return false;
+    }
+    return true;
 }
 
 // bitset -> one-hot
-typedef uint32_t (*_CandidateExtractor)(uint32_t);
+typedef uint32_t (*_CandidateExtractor)(uint32_t, Rng*);
 
-uint32_t extract_smallest_candidate(uint32_t set) {
+uint32_t extract_smallest_candidate(uint32_t set, Rng *rng) {
     return set & -set;
 }
 
-uint32_t extract_largest_candidate(uint32_t set) {
+uint32_t extract_largest_candidate(uint32_t set, Rng *rng) {
     return 1u << highest_set_bit_index(set);
 }
 
-uint32_t extract_random_candidate(uint32_t set) {
+uint32_t extract_random_candidate(uint32_t set, Rng *rng) {
     uint32_t count = population_count(set);
-    uint32_t idx = random(0, count) + 1;
+    uint32_t idx = rng_range(rng, 0, count) + 1;
     uint32_t candidate = 0;
     for (uint32_t i = 0; i < idx; ++i) {
-        candidate = extract_smallest_candidate(set);
+        candidate = extract_smallest_candidate(set, rng);
         set &= ~candidate;
     }
     return candidate;
 }
 
 
-bool solve(Sudoku *sudoku, _CandidateExtractor extract) {
+bool solve(Sudoku *sudoku, _CandidateExtractor extract, Rng *rng) {
 
     while (singles(sudoku) || hidden_singles(sudoku));
 
@@ -247,10 +313,10 @@ bool solve(Sudoku *sudoku, _CandidateExtractor extract) {
     uint32_t candidates = sudoku->data[mindex] >> SHIFT;
     while (candidates) {
 
-        uint32_t c = extract(candidates);
+        uint32_t c = extract(candidates, rng);
         put(sudoku, mindex, c);
 
-        if (solve(sudoku, extract))
+        if (solve(sudoku, extract, rng))
             return true;
 
         // restore copy
@@ -263,15 +329,18 @@ bool solve(Sudoku *sudoku, _CandidateExtractor extract) {
 }
 
 bool sudoku_solve(Sudoku *sudoku) {
-    return solve(sudoku, extract_smallest_candidate);
+    return solve(sudoku, extract_smallest_candidate, NULL);
 }
 
 bool sudoku_solve_reverse(Sudoku *sudoku) {
-    return solve(sudoku, extract_largest_candidate);
+    return solve(sudoku, extract_largest_candidate, NULL);
 }
 
-bool sudoku_solve_random(Sudoku *sudoku) {
-    return solve(sudoku, extract_random_candidate);
+bool sudoku_solve_random(Sudoku *sudoku, Rng *rng) {
+    TRACE_BEGIN(span);
+    bool solved = solve(sudoku, extract_random_candidate, rng);
+    TRACE_END(span, "fill");
+    return solved;
 }
 
 bool sudoku_equal_values(const Sudoku *lhs, const Sudoku *rhs) {
@@ -304,13 +373,19 @@ void sudoku_from_buffer(Sudoku* sudoku, const uint32_t* buffer) {
     }
 }
 
-void sudoku_from_string(Sudoku* sudoku, const char* buffer) {
+bool sudoku_from_string(Sudoku* sudoku, const char* buffer) {
     sudoku_init(sudoku);
+    bool valid = true;
     for (uint32_t i = 0; i < 81u; ++i) {
-        if (buffer[i] == '0')
+        if (buffer[i] == '0' || buffer[i] == '.')
             continue;
+        if (buffer[i] < '1' || buffer[i] > '9') {
+            valid = false;
+            continue;
+        }
         sudoku_put_value(sudoku, i, buffer[i] - '0');
     }
+    return valid;
 }
 
 void sudoku_to_string(const Sudoku *sudoku, char *out) {
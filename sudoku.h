@@ -1,6 +1,8 @@
 #ifndef SUDOKU_H
 #define SUDOKU_H
 
+#include "rng.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -20,16 +22,26 @@ typedef struct {
 Sudoku sudoku_new_empty();
 void sudoku_init(Sudoku *sudoku);
 void sudoku_from_buffer(Sudoku* sudoku, const uint32_t* buffer);
-void sudoku_from_string(Sudoku* sudoku, const char* buffer);
+// 81 characters, '1'-'9' are hints and '0' or '.' blank fields
+// any other character is left blank and makes it return false
+bool sudoku_from_string(Sudoku* sudoku, const char* buffer);
 bool sudoku_solve(Sudoku *sudoku);
 bool sudoku_solve_reverse(Sudoku *sudoku);
-bool sudoku_solve_random(Sudoku *sudoku);
+bool sudoku_solve_random(Sudoku *sudoku, Rng *rng);
+// the naked and hidden singles that the solvers apply before branching
+// returns false on a contradiction in a single field or unit, a filled grid it returns true for is a solution
+// contradictions spanning several fields may go undetected until the grid is filled
+bool sudoku_propagate(Sudoku *sudoku);
+// no unit holds a digit twice
+bool hints_consistent(const Sudoku *sudoku);
+void sudoku_to_string(const Sudoku *sudoku, char *out);
 void sudoku_print(const Sudoku *sudoku);
 void sudoku_pprint(const Sudoku *sudoku);
 bool sudoku_equal_values(const Sudoku *lhs, const Sudoku *rhs);
 void sudoku_put_one_hot_value(Sudoku *sudoku, uint32_t field, uint32_t candidate);
 void sudoku_put_value(Sudoku *sudoku, uint32_t field, uint32_t candidate);
 void sudoku_clear_field(Sudoku *sudoku, uint32_t field);
+void sudoku_exclude_one_hot_candidate(Sudoku *sudoku, uint32_t field, uint32_t candidate);
 uint32_t sudoku_read_value(const Sudoku *sudoku, uint32_t field);
 
 #endif
@@ -0,0 +1,174 @@
+#include "sudokugen.h"
+#include "generator.h"
+#include "bandit.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+struct SudokuGenContext {
+    SudokuGenConfig config;
+    SudokuGenStats stats;
+    Rng rng;
+    CancelFlag cancel;
+};
+
+
+SudokuGenConfig sudokugen_default_config() {
+    SudokuGenConfig config;
+    config.strategy = SUDOKUGEN_TIME_BOUNDED;
+    config.max_hints = 24;
+    config.max_attempts_per_field = 1;
+    config.max_seconds = 0.1f;
+    config.restarts = restart_default_schedule();
+    config.max_nodes = 0;
+    config.max_checks = 0;
+    config.symmetry = SYMMETRY_NONE;
+    config.exact_hints = 0;
+    config.exact_max_searches = 0;
+    config.heuristic = max_neighbors_heuristic;
+    config.heuristic_state = NULL;
+    return config;
+}
+
+
+SudokuGenContext* sudokugen_create(const SudokuGenConfig* config, uint64_t seed) {
+    SudokuGenContext* context = malloc(sizeof(SudokuGenContext));
+    if (!context)
+        return NULL;
+    context->config = *config;
+    budget_reset_cancel(&context->cancel);
+    sudokugen_reseed(context, seed);
+    sudokugen_reset_stats(context);
+    return context;
+}
+
+
+void sudokugen_destroy(SudokuGenContext* context) {
+    free(context);
+}
+
+
+void sudokugen_configure(SudokuGenContext* context, const SudokuGenConfig* config) {
+    context->config = *config;
+}
+
+
+void sudokugen_reseed(SudokuGenContext* context, uint64_t seed) {
+    rng_seed(&context->rng, seed);
+}
+
+
+SudokuGenStats sudokugen_stats(const SudokuGenContext* context) {
+    return context->stats;
+}
+
+
+void sudokugen_reset_stats(SudokuGenContext* context) {
+    memset(&context->stats, 0, sizeof(SudokuGenStats));
+}
+
+
+Sudoku remove_hints(const SudokuGenConfig* config, void* heuristic_state, const Sudoku* solution, SearchBudget* budget, Rng* rng) {
+    switch (config->strategy) {
+        case SUDOKUGEN_NAIVE:
+            return remove_hints_naive(solution, config->symmetry, budget, rng);
+        case SUDOKUGEN_EXHAUSTIVE:
+            return remove_hints_exhaustive(solution, config->symmetry, config->max_hints, budget, config->heuristic, heuristic_state, rng);
+        case SUDOKUGEN_BOUNDED:
+            return remove_hints_bounded(solution, config->symmetry, config->max_attempts_per_field, budget, config->heuristic, heuristic_state, rng);
+        case SUDOKUGEN_TIME_BOUNDED:
+        default:
+            budget_set_seconds(budget, config->max_seconds);
+            if (config->restarts.policy != RESTART_NONE)
+                return remove_hints_with_restarts(solution, config->symmetry, &config->restarts, budget, config->heuristic, heuristic_state, rng);
+            return remove_hints_time_bounded(solution, config->symmetry, budget, config->heuristic, heuristic_state, rng);
+    }
+}
+
+
+Sudoku search_one(const SudokuGenConfig* config, void* heuristic_state, const Sudoku* solution, CancelFlag* cancel, Rng* rng) {
+    SearchBudget budget;
+    budget_init(&budget);
+    budget.cancel = cancel;
+    if (config->max_nodes) budget.max_nodes = config->max_nodes;
+    if (config->max_checks) budget.max_checks = config->max_checks;
+    if (config->heuristic != bandit_heuristic)
+        return remove_hints(config, heuristic_state, solution, &budget, rng);
+
+    // the bandit learns from every search
+    BanditHeuristic* bandit = heuristic_state;
+    bandit_begin_search(bandit);
+    Sudoku instance = remove_hints(config, heuristic_state, solution, &budget, rng);
+    bandit_end_search(bandit, instance.blank_fields);
+    return instance;
+}
+
+
+bool sudokugen_search(const SudokuGenConfig* config, void* heuristic_state, const Sudoku* solution, CancelFlag* cancel, Rng* rng, SudokuGenStats* stats, Sudoku* instance) {
+    uint32_t hints = config->exact_hints;
+    Sudoku grid = *solution;
+    for (uint32_t search = 0; !hints || !config->exact_max_searches || search < config->exact_max_searches; ++search) {
+        if (search > 0) {
+            grid = sudoku_new_empty();
+            sudoku_solve_random(&grid, rng);
+        }
+        *instance = search_one(config, heuristic_state, &grid, cancel, rng);
+        if (stats) stats->searches += 1;
+        if (cancel && *cancel)
+            return false;
+        if (!hints)
+            return true;
+
+        // searches that end above the count are dropped, those below it are filled up rather than wasted
+        uint32_t found = 81 - instance->blank_fields;
+        if (found > hints)
+            continue;
+        // restarts search from new solutions, so the hints come from the unique solution of the instance itself
+        Sudoku own_solution = *instance;
+        sudoku_solve(&own_solution);
+        if (add_hints_from_solution(instance, &own_solution, config->symmetry, hints, rng)) {
+            if (stats) stats->hints_added += hints - found;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+uint32_t sudokugen_generate(SudokuGenContext* context, char* out, uint32_t count) {
+    budget_reset_cancel(&context->cancel);
+    for (uint32_t i = 0; i < count; ++i) {
+        Sudoku solution = sudoku_new_empty();
+        sudoku_solve_random(&solution, &context->rng);
+        Sudoku s;
+        if (!sudokugen_search(&context->config, context->config.heuristic_state, &solution, &context->cancel, &context->rng, &context->stats, &s))
+            return i;
+        sudoku_to_string(&s, out + i * SUDOKUGEN_CHARS_PER_INSTANCE);
+        context->stats.instances_generated += 1;
+        context->stats.hints_generated += 81 - s.blank_fields;
+    }
+    return count;
+}
+
+
+void sudokugen_cancel(SudokuGenContext* context) {
+    budget_cancel(&context->cancel);
+}
+
+
+uint32_t sudokugen_solve(SudokuGenContext* context, const char* in, char* out, uint32_t count) {
+    uint32_t solved = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        Sudoku s;
+        if (!sudoku_from_string(&s, in + i * SUDOKUGEN_CHARS_PER_INSTANCE) || !sudoku_solve(&s)) {
+            memmove(out + i * SUDOKUGEN_CHARS_PER_INSTANCE, in + i * SUDOKUGEN_CHARS_PER_INSTANCE, SUDOKUGEN_CHARS_PER_INSTANCE);
+            context->stats.instances_unsolvable += 1;
+            continue;
+        }
+        sudoku_to_string(&s, out + i * SUDOKUGEN_CHARS_PER_INSTANCE);
+        context->stats.instances_solved += 1;
+        ++solved;
+    }
+    return solved;
+}
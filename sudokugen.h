@@ -0,0 +1,104 @@
+#ifndef SUDOKUGEN_H
+#define SUDOKUGEN_H
+
+#include "heuristics.h"
+#include "generator.h"
+
+#include <stdint.h>
+
+// public interface of libsudokugen
+// all mutable state (random number generator, configuration, statistics) lives in an opaque context
+// contexts are independent of each other, so different threads may use different contexts concurrently
+// a single context must not be used by multiple threads at the same time
+// the batch calls do not allocate any memory, results are written to caller-provided buffers
+// puzzles are exchanged as 81 characters '0'-'9' per instance, row by row, where '0' denotes an empty field
+// there is neither a separator between instances nor a terminating null character
+
+typedef enum {
+    SUDOKUGEN_NAIVE,
+    SUDOKUGEN_EXHAUSTIVE,
+    SUDOKUGEN_BOUNDED,
+    SUDOKUGEN_TIME_BOUNDED
+} SudokuGenStrategy;
+
+typedef struct {
+    SudokuGenStrategy strategy;
+    // SUDOKUGEN_EXHAUSTIVE only
+    uint32_t max_hints;
+    // SUDOKUGEN_BOUNDED only
+    uint32_t max_attempts_per_field;
+    // SUDOKUGEN_TIME_BOUNDED only, wall-clock seconds per instance
+    float max_seconds;
+    // SUDOKUGEN_TIME_BOUNDED only, restarts from new solutions within max_seconds, RESTART_NONE keeps a single one
+    RestartSchedule restarts;
+    // per instance, 0 means unlimited
+    // unlike max_seconds these do not depend on the machine, which makes runs reproducible
+    // a node is one removal step, a check is one hint tested for removability
+    uint64_t max_nodes;
+    uint64_t max_checks;
+    // all strategies, hints are cleared in orbits so that every instance has this symmetry
+    Symmetry symmetry;
+    // all strategies, 0 to disable, otherwise every instance has exactly this many hints
+    // searches from new solutions are run until one ends at or below the count, hints of its solution then fill it up
+    // every search minimizes as usual, so the lower the count, the fewer searches are dropped for ending above it
+    uint32_t exact_hints;
+    // exact_hints only, searches per instance before giving up, 0 for unlimited
+    // counts near MIN_UNIQUE_HINTS are rarely reached, without a limit only sudokugen_cancel ends the retries
+    uint32_t exact_max_searches;
+    // ignored by SUDOKUGEN_NAIVE, the state is owned by the caller and has to outlive the context
+    OrderHeuristic heuristic;
+    void* heuristic_state;
+} SudokuGenConfig;
+
+typedef struct {
+    uint64_t instances_generated;
+    // sum over all generated instances, divide by instances_generated for the average
+    uint64_t hints_generated;
+    // one per instance, plus the searches that exact_hints rejected for ending above the count
+    uint64_t searches;
+    // hints put back to reach exact_hints
+    uint64_t hints_added;
+    uint64_t instances_solved;
+    uint64_t instances_unsolvable;
+} SudokuGenStats;
+
+typedef struct SudokuGenContext SudokuGenContext;
+
+#define SUDOKUGEN_CHARS_PER_INSTANCE 81u
+
+SudokuGenConfig sudokugen_default_config();
+
+// returns NULL if the context could not be allocated
+SudokuGenContext* sudokugen_create(const SudokuGenConfig* config, uint64_t seed);
+void sudokugen_destroy(SudokuGenContext* context);
+
+void sudokugen_configure(SudokuGenContext* context, const SudokuGenConfig* config);
+void sudokugen_reseed(SudokuGenContext* context, uint64_t seed);
+SudokuGenStats sudokugen_stats(const SudokuGenContext* context);
+void sudokugen_reset_stats(SudokuGenContext* context);
+
+// generates count instances into out, which must hold count * SUDOKUGEN_CHARS_PER_INSTANCE characters
+// returns the number of instances generated, which is lower than count only if the call was cancelled
+// or exact_max_searches searches did not yield an instance with exact_hints hints
+uint32_t sudokugen_generate(SudokuGenContext* context, char* out, uint32_t count);
+
+// one instance from the given solution with the strategy, budgets and exact hint count of the config, as used by
+// sudokugen_generate, for callers running their own threads such as the pipeline
+// heuristic_state is used instead of config->heuristic_state, e.g. a bandit of the calling thread
+// with exact_hints, searches ending above the count are followed by searches from new random solutions
+// cancel may be NULL, the searches and hints added are added to stats unless it is NULL
+// returns false if cancelled or out of searches, the instance is then incomplete
+bool sudokugen_search(const SudokuGenConfig* config, void* heuristic_state, const Sudoku* solution, CancelFlag* cancel, Rng* rng, SudokuGenStats* stats, Sudoku* instance);
+
+// makes a running sudokugen_generate call on this context return as soon as possible, the instance in progress is dropped
+// may be called from any thread, calls to sudokugen_generate starting afterwards are not affected
+void sudokugen_cancel(SudokuGenContext* context);
+
+// solves count instances from in into out, both holding count * SUDOKUGEN_CHARS_PER_INSTANCE characters
+// in and out may point to the same buffer
+// unsolvable instances and instances with characters other than '0'-'9' or '.' are copied to out unchanged
+// and counted as unsolvable
+// returns the number of solved instances
+uint32_t sudokugen_solve(SudokuGenContext* context, const char* in, char* out, uint32_t count);
+
+#endif
@@ -0,0 +1,93 @@
+#include "symmetry.h"
+#include "utils.h"
+
+
+// every supported symmetry is generated by a single mapping, the orbit of a field is the cycle through it
+uint32_t map_field(Symmetry symmetry, uint32_t field) {
+    uint32_t row = field / 9, column = field % 9;
+    switch (symmetry) {
+        case SYMMETRY_ROTATE_180:
+            return (8 - row) * 9 + (8 - column);
+        case SYMMETRY_ROTATE_90:
+            return column * 9 + (8 - row);
+        case SYMMETRY_MIRROR_VERTICAL:
+            return row * 9 + (8 - column);
+        case SYMMETRY_MIRROR_HORIZONTAL:
+            return (8 - row) * 9 + column;
+        case SYMMETRY_MIRROR_DIAGONAL:
+            return column * 9 + row;
+        case SYMMETRY_NONE:
+        default:
+            return field;
+    }
+}
+
+
+uint32_t symmetry_orbit(Symmetry symmetry, uint32_t field, uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE]) {
+    uint32_t size = 0;
+    uint32_t current = field;
+    do {
+        orbit[size++] = current;
+        current = map_field(symmetry, current);
+    } while (current != field && size < SYMMETRY_MAX_ORBIT_SIZE);
+    return size;
+}
+
+
+bool symmetry_is_representative(Symmetry symmetry, uint32_t field) {
+    uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+    uint32_t size = symmetry_orbit(symmetry, field, orbit);
+    for (uint32_t i = 1; i < size; ++i) {
+        if (orbit[i] < field)
+            return false;
+    }
+    return true;
+}
+
+
+void ofs_set_orbits(OrderedFieldSubset* fields, Symmetry symmetry) {
+    fields->size = 0;
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if (symmetry_is_representative(symmetry, i))
+            fields->indices[fields->size++] = i;
+    }
+}
+
+
+void ofs_find_nonempty_orbits(OrderedFieldSubset* fields, Sudoku* s, Symmetry symmetry) {
+    fields->size = 0;
+    for (uint32_t i = 0; i < 81u; ++i) {
+        if ((s->data[i] & LOWER) && symmetry_is_representative(symmetry, i))
+            fields->indices[fields->size++] = i;
+    }
+}
+
+
+uint32_t ofs_count_orbit_fields(const OrderedFieldSubset* fields, uint32_t offset, uint32_t count, Symmetry symmetry) {
+    if (symmetry == SYMMETRY_NONE)
+        return count;
+    uint32_t total = 0;
+    uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+    for (uint32_t i = offset; i < offset + count; ++i) {
+        total += symmetry_orbit(symmetry, fields->indices[i], orbit);
+    }
+    return total;
+}
+
+
+void sudoku_clear_orbit(Sudoku* s, Symmetry symmetry, uint32_t field) {
+    uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+    uint32_t size = symmetry_orbit(symmetry, field, orbit);
+    for (uint32_t i = 0; i < size; ++i) {
+        sudoku_clear_field(s, orbit[i]);
+    }
+}
+
+
+void sudoku_restore_orbit(Sudoku* s, const Sudoku* solution, Symmetry symmetry, uint32_t field) {
+    uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE];
+    uint32_t size = symmetry_orbit(symmetry, field, orbit);
+    for (uint32_t i = 0; i < size; ++i) {
+        sudoku_put_one_hot_value(s, orbit[i], solution->data[orbit[i]] & LOWER);
+    }
+}
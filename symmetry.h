@@ -0,0 +1,46 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include "sudoku.h"
+#include "field_subset.h"
+
+#include <stdint.h>
+
+// symmetric instances have their hints on fields that are mapped onto each other by a symmetry of the grid
+// the fields mapped onto each other form an orbit, hints are always cleared and restored for whole orbits
+// an orbit is represented by its smallest field, searches only ever see the representatives
+// so the search tree shrinks by the orbit size, but all heuristics and removability checks work unchanged
+
+typedef enum {
+    SYMMETRY_NONE,
+    // 180 degree rotation about the center, orbits are pairs
+    SYMMETRY_ROTATE_180,
+    // 90 degree rotation about the center, orbits are quadruples
+    SYMMETRY_ROTATE_90,
+    // column c is mirrored onto column 8 - c
+    SYMMETRY_MIRROR_VERTICAL,
+    // row r is mirrored onto row 8 - r
+    SYMMETRY_MIRROR_HORIZONTAL,
+    // mirror at the main diagonal, row r is mapped onto column r
+    SYMMETRY_MIRROR_DIAGONAL
+} Symmetry;
+
+#define SYMMETRY_MAX_ORBIT_SIZE 4u
+
+// writes the fields of the orbit of field to orbit, starting with field itself, and returns their number
+uint32_t symmetry_orbit(Symmetry symmetry, uint32_t field, uint32_t orbit[SYMMETRY_MAX_ORBIT_SIZE]);
+bool symmetry_is_representative(Symmetry symmetry, uint32_t field);
+
+// all orbit representatives in increasing order
+void ofs_set_orbits(OrderedFieldSubset* fields, Symmetry symmetry);
+// orbit representatives whose fields are nonempty
+void ofs_find_nonempty_orbits(OrderedFieldSubset* fields, Sudoku* s, Symmetry symmetry);
+
+// number of fields in the orbits represented by the index range [offset, offset + count)
+uint32_t ofs_count_orbit_fields(const OrderedFieldSubset* fields, uint32_t offset, uint32_t count, Symmetry symmetry);
+
+void sudoku_clear_orbit(Sudoku* s, Symmetry symmetry, uint32_t field);
+// puts the values of the solution back into all fields of the orbit
+void sudoku_restore_orbit(Sudoku* s, const Sudoku* solution, Symmetry symmetry, uint32_t field);
+
+#endif
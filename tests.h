@@ -9,7 +9,7 @@
 #include <time.h>
 
 
-inline void test() {
+static inline void test() {
     Sudoku s;
     uint32_t wikipedia[81] = {
             5, 3, 0,   0, 7, 0,   0, 0, 0,
@@ -77,36 +77,40 @@ inline void test() {
 }
 
 
-inline void generate() {
+static inline void generate() {
+    Rng rng;
+    rng_seed(&rng, time(NULL));
     {
-        Sudoku s = generate_sudoku_naive();
+        Sudoku s = generate_sudoku_naive(&rng);
         sudoku_print(&s);
     }
     {
         const float max_seconds_per_instance = 5;
-        Sudoku s = generate_sudoku_with_min_hints_time_bounded(max_seconds_per_instance, min_neighbors_heuristic, NULL);
+        Sudoku s = generate_sudoku_with_min_hints_time_bounded(max_seconds_per_instance, min_neighbors_heuristic, NULL, &rng);
         sudoku_print(&s);
     }
     {
         const uint32_t max_hints_per_instance = 22;
-        Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_hints_per_instance, min_neighbors_heuristic, NULL);
+        Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_hints_per_instance, min_neighbors_heuristic, NULL, &rng);
         sudoku_print(&s);
     }
     {
         const uint32_t max_attempts_per_field = 2;
-        Sudoku s = generate_sudoku_with_min_hints_bounded(max_attempts_per_field, min_neighbors_heuristic, NULL);
+        Sudoku s = generate_sudoku_with_min_hints_bounded(max_attempts_per_field, min_neighbors_heuristic, NULL, &rng);
         sudoku_print(&s);
     }
 }
 
 
-inline void measure() {
+static inline void measure() {
+    Rng rng;
+    rng_seed(&rng, time(NULL));
     uint32_t max_candidates = 23;
     uint32_t runs = 100;
     {
         clock_t start = clock();
         for (uint32_t i = 0; i < runs; ++i) {
-            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, max_neighbors_heuristic, NULL);
+            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, max_neighbors_heuristic, NULL, &rng);
         }
         clock_t end = clock();
         float seconds = (float) (end - start) / CLOCKS_PER_SEC;
@@ -115,7 +119,7 @@ inline void measure() {
     {
         clock_t start = clock();
         for (uint32_t i = 0; i < runs; ++i) {
-            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, min_neighbors_heuristic, NULL);
+            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, min_neighbors_heuristic, NULL, &rng);
         }
         clock_t end = clock();
         float seconds = (float) (end - start) / CLOCKS_PER_SEC;
@@ -124,7 +128,7 @@ inline void measure() {
     {
         clock_t start = clock();
         for (uint32_t i = 0; i < runs; ++i) {
-            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, most_frequent_digit_heuristic, NULL);
+            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, most_frequent_digit_heuristic, NULL, &rng);
         }
         clock_t end = clock();
         float seconds = (float) (end - start) / CLOCKS_PER_SEC;
@@ -133,7 +137,7 @@ inline void measure() {
     {
         clock_t start = clock();
         for (uint32_t i = 0; i < runs; ++i) {
-            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, least_frequent_digit_heuristic, NULL);
+            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, least_frequent_digit_heuristic, NULL, &rng);
         }
         clock_t end = clock();
         float seconds = (float) (end - start) / CLOCKS_PER_SEC;
@@ -142,7 +146,7 @@ inline void measure() {
     {
         clock_t start = clock();
         for (uint32_t i = 0; i < runs; ++i) {
-            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, no_heuristic, NULL);
+            Sudoku s = generate_sudoku_with_min_hints_exhaustive(max_candidates, no_heuristic, NULL, &rng);
         }
         clock_t end = clock();
         float seconds = (float) (end - start) / CLOCKS_PER_SEC;
@@ -150,4 +154,80 @@ inline void measure() {
     }
 }
 
+
+static inline int compare_hints(const void* lhs, const void* rhs) {
+    return (int) *(const uint32_t*) lhs - (int) *(const uint32_t*) rhs;
+}
+
+
+// time-bounded generation with and without restarts at the same budget of removability checks per instance
+// prints the mean hint count and the tail (90th percentile and worst instance)
+static inline void measure_restarts(uint32_t runs, uint64_t checks_per_instance) {
+    if (runs == 0)
+        return;
+    const char* names[3] = {"No restarts", "Luby restarts", "Geometric restarts"};
+    uint32_t* hints = malloc(runs * sizeof(uint32_t));
+    if (!hints) return;
+    for (uint32_t policy = RESTART_NONE; policy <= RESTART_GEOMETRIC; ++policy) {
+        RestartSchedule schedule = restart_default_schedule();
+        schedule.policy = (RestartPolicy) policy;
+        // the searches draw a different number of values per policy, so solutions come from a generator of their own
+        // seeded per instance, which gives every policy the same solutions
+        Rng rng;
+        rng_seed(&rng, 0);
+        uint64_t sum = 0;
+        for (uint32_t i = 0; i < runs; ++i) {
+            Rng solution_rng;
+            rng_seed(&solution_rng, i);
+            Sudoku solution = sudoku_new_empty();
+            sudoku_solve_random(&solution, &solution_rng);
+            SearchBudget budget;
+            budget_init(&budget);
+            budget.max_checks = checks_per_instance;
+            Sudoku s = policy == RESTART_NONE
+                    ? remove_hints_time_bounded(&solution, SYMMETRY_NONE, &budget, max_neighbors_heuristic, NULL, &rng)
+                    : remove_hints_with_restarts(&solution, SYMMETRY_NONE, &schedule, &budget, max_neighbors_heuristic, NULL, &rng);
+            hints[i] = 81 - s.blank_fields;
+            sum += hints[i];
+        }
+        qsort(hints, runs, sizeof(uint32_t), compare_hints);
+        printf("%s: mean %.2f hints, 90th percentile %u, worst %u\n",
+               names[policy], (double) sum / runs, hints[(runs * 9) / 10 < runs ? (runs * 9) / 10 : runs - 1], hints[runs - 1]);
+    }
+    free(hints);
+}
+
+
+static inline void print_check_tiers(const char* workload, UniquenessStats stats, double seconds) {
+    uint64_t total = stats.propagation + stats.probe + stats.search;
+    double scale = total ? 100.0 / total : 0.0;
+    printf("%s: %llu checks in %.3f s, propagation %.1f %%, probe %.1f %%, search %.1f %%\n", workload, (unsigned long long) total,
+           seconds, stats.propagation * scale, stats.probe * scale, stats.search * scale);
+}
+
+
+// which tier decides the checks of the naive strategy (uniqueness checks) and of the time-bounded one (removability checks)
+static inline void measure_check_tiers(uint32_t runs, uint64_t checks_per_instance) {
+    Rng rng;
+    rng_seed(&rng, 0);
+    uniqueness_reset_stats();
+    clock_t start = clock();
+    for (uint32_t i = 0; i < runs; ++i) {
+        generate_sudoku_naive(&rng);
+    }
+    print_check_tiers("Naive", uniqueness_stats(), (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    uniqueness_reset_stats();
+    start = clock();
+    for (uint32_t i = 0; i < runs; ++i) {
+        Sudoku solution = sudoku_new_empty();
+        sudoku_solve_random(&solution, &rng);
+        SearchBudget budget;
+        budget_init(&budget);
+        budget.max_checks = checks_per_instance;
+        remove_hints_time_bounded(&solution, SYMMETRY_NONE, &budget, max_neighbors_heuristic, NULL, &rng);
+    }
+    print_check_tiers("Time-bounded", uniqueness_stats(), (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
 #endif
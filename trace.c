@@ -0,0 +1,135 @@
+#include "trace.h"
+#include "utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef SUDOKUGEN_TRACE
+
+// threads beyond this number are not traced
+#define TRACE_MAX_THREADS 256u
+
+typedef struct {
+    const char* name;
+    double start;
+    double duration;
+} TraceEvent;
+
+typedef struct {
+    // events ever recorded, the ring holds the last TRACE_BUFFER_EVENTS of them
+    uint64_t count;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+atomic_int trace_active;
+
+static atomic_uint thread_count;
+static _Atomic(TraceBuffer*) buffers[TRACE_MAX_THREADS];
+static THREAD_LOCAL TraceBuffer* thread_buffer;
+// set if the buffer of this thread could not be registered
+static THREAD_LOCAL bool thread_untraced;
+
+static char* trace_path;
+static double trace_origin;
+static double trace_min_slow;
+
+
+void trace_record(const char* name, double start, double end) {
+    TraceBuffer* buffer = thread_buffer;
+    if (!buffer) {
+        if (thread_untraced)
+            return;
+        uint32_t index = atomic_fetch_add(&thread_count, 1u);
+        buffer = index < TRACE_MAX_THREADS ? malloc(sizeof(TraceBuffer)) : NULL;
+        if (!buffer) {
+            thread_untraced = true;
+            return;
+        }
+        buffer->count = 0;
+        atomic_store(&buffers[index], buffer);
+        thread_buffer = buffer;
+    }
+    TraceEvent* event = buffer->events + (buffer->count++ & (TRACE_BUFFER_EVENTS - 1));
+    event->name = name;
+    event->start = start;
+    event->duration = end - start;
+}
+
+
+void trace_end(const TraceSpan* span, const char* name) {
+    if (span->start != 0.0 && trace_is_active())
+        trace_record(name, span->start, monotonic_seconds());
+}
+
+
+void trace_end_slow(const TraceSpan* span, const char* name) {
+    if (span->start == 0.0 || !trace_is_active())
+        return;
+    double end = monotonic_seconds();
+    if (end - span->start >= trace_min_slow)
+        trace_record(name, span->start, end);
+}
+
+
+bool trace_start(const char* path, double min_slow_seconds) {
+    if (trace_is_active() || trace_path)
+        return false;
+    trace_path = malloc(strlen(path) + 1);
+    if (!trace_path)
+        return false;
+    strcpy(trace_path, path);
+    trace_origin = monotonic_seconds();
+    trace_min_slow = min_slow_seconds;
+    atomic_store(&trace_active, 1);
+    return true;
+}
+
+
+bool trace_finish() {
+    if (!trace_path)
+        return true;
+    atomic_store(&trace_active, 0);
+    FILE* file = fopen(trace_path, "w");
+    free(trace_path);
+    trace_path = NULL;
+    if (!file)
+        return false;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    uint32_t threads = atomic_load(&thread_count);
+    bool first = true;
+    for (uint32_t t = 0; t < threads && t < TRACE_MAX_THREADS; ++t) {
+        const TraceBuffer* buffer = atomic_load(&buffers[t]);
+        if (!buffer)
+            continue;
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                first ? "" : ",\n", t + 1, t + 1);
+        first = false;
+        uint64_t begin = buffer->count > TRACE_BUFFER_EVENTS ? buffer->count - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t i = begin; i < buffer->count; ++i) {
+            const TraceEvent* event = buffer->events + (i & (TRACE_BUFFER_EVENTS - 1));
+            // microseconds since the start of the trace
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    event->name, t + 1, (event->start - trace_origin) * 1e6, event->duration * 1e6);
+        }
+    }
+    fputs("\n]}\n", file);
+    return fclose(file) == 0;
+}
+
+#else
+
+bool trace_start(const char* path, double min_slow_seconds) {
+    (void) path;
+    (void) min_slow_seconds;
+    return false;
+}
+
+
+bool trace_finish() {
+    return true;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+// timeline of the phases of generation and solving per thread, written as Chrome trace event JSON
+// which chrome://tracing and ui.perfetto.dev display as one track per thread
+// every phase becomes one complete event with its start and duration, recorded when it ends
+// events go into a ring buffer per thread, so only the most recent TRACE_BUFFER_EVENTS per thread are kept
+// and recording needs neither locks nor allocations after the first event of a thread
+// without SUDOKUGEN_TRACE the macros below compile to nothing, with it they cost one relaxed load while tracing is off
+
+#define TRACE_BUFFER_EVENTS 65536u
+
+// threads register their buffers with atomics
+#if defined(SUDOKUGEN_TRACE) && defined(__STDC_NO_ATOMICS__)
+#undef SUDOKUGEN_TRACE
+#endif
+
+#ifdef SUDOKUGEN_TRACE
+
+#include "monotonic.h"
+
+#include <stdatomic.h>
+
+extern atomic_int trace_active;
+#define trace_is_active() (atomic_load_explicit(&trace_active, memory_order_relaxed) != 0)
+
+typedef struct {
+    // monotonic_seconds() at the beginning, 0 if tracing was off then
+    double start;
+} TraceSpan;
+
+static inline TraceSpan trace_begin() {
+    TraceSpan span = {trace_is_active() ? monotonic_seconds() : 0.0};
+    return span;
+}
+
+// name must be a string literal or live until the trace is written
+void trace_end(const TraceSpan* span, const char* name);
+// drops the event if the span was shorter than the threshold passed to trace_start
+void trace_end_slow(const TraceSpan* span, const char* name);
+
+#define TRACE_BEGIN(span) TraceSpan span = trace_begin()
+#define TRACE_END(span, name) trace_end(&span, name)
+#define TRACE_END_SLOW(span, name) trace_end_slow(&span, name)
+
+#else
+
+#define TRACE_BEGIN(span) ((void) 0)
+#define TRACE_END(span, name) ((void) 0)
+#define TRACE_END_SLOW(span, name) ((void) 0)
+
+#endif
+
+// starts recording, events end up in the file at path once trace_finish is called
+// events passed to TRACE_END_SLOW are only kept if they took at least min_slow_seconds
+// returns false if tracing is not compiled in or already started
+bool trace_start(const char* path, double min_slow_seconds);
+// stops recording and writes all buffered events, e.g. from atexit, the buffers are kept until the process exits
+// threads still recording may lose their last events, returns false if the file could not be written
+bool trace_finish();
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef UNITS_H
+#define UNITS_H
+
+#include <stdint.h>
+
+// the 27 units (rows, columns and squares) of the grid and the 20 peers of every field
+// a field's peers are all other fields sharing a unit with it
+
+#define UNIT_COUNT 27u
+#define PEER_COUNT 20u
+
+// rows 0-8, columns 9-17, squares 18-26, fields in row-major order
+extern const uint8_t UNIT_FIELDS[UNIT_COUNT][9];
+// row, column and square of every field
+extern const uint8_t FIELD_UNITS[81][3];
+// in increasing order
+extern const uint8_t FIELD_PEERS[81][PEER_COUNT];
+
+#endif
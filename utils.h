@@ -19,21 +19,21 @@ static const uint32_t NO_CANDIDATES  = 0x000u;
 #define MSVC
 #endif
 
+#ifdef MSVC
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
 
-inline uint32_t random(uint32_t inclusive_start, uint32_t exclusive_end) {
-    return rand() % (exclusive_end - inclusive_start) + inclusive_start;
-}
 
-inline void random_shuffle(uint32_t *buffer, uint32_t length) {
-    for (uint32_t i = 0; i < length - 1; ++i) {
-        uint32_t j = random(i, length);
-        uint32_t temp = buffer[i];
-        buffer[i] = buffer[j];
-        buffer[j] = temp;
-    }
+// msvc defines min as a macro in stdlib.h
+#ifndef min
+static inline uint32_t min(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
 }
+#endif
 
-inline uint32_t lowest_set_bit_index(uint32_t value) {
+static inline uint32_t lowest_set_bit_index(uint32_t value) {
 #ifdef MSVC
     unsigned long index;
     _BitScanForward(&index, value);
@@ -43,25 +43,25 @@ inline uint32_t lowest_set_bit_index(uint32_t value) {
 #endif
 }
 
-inline uint32_t safe_lowest_set_bit_index(uint32_t value) {
+static inline uint32_t safe_lowest_set_bit_index(uint32_t value) {
     return value == 0 ? FULL32 : lowest_set_bit_index(value);
 }
 
-inline uint32_t highest_set_bit_index(uint32_t value) {
+static inline uint32_t highest_set_bit_index(uint32_t value) {
 #ifdef MSVC
     unsigned long index;
     _BitScanReverse(&index, value);
     return (uint32_t) index;
 #else
-    return sizeof(unsigned int) - 1 - __builtin_clz(value);
+    return sizeof(unsigned int) * 8 - 1 - __builtin_clz(value);
 #endif
 }
 
-inline uint32_t safe_highest_set_bit_index(uint32_t value) {
+static inline uint32_t safe_highest_set_bit_index(uint32_t value) {
     return value == 0 ? FULL32 : highest_set_bit_index(value);
 }
 
-inline uint32_t population_count(uint32_t value) {
+static inline uint32_t population_count(uint32_t value) {
 #ifdef MSVC
     return __popcnt(value);
 #else